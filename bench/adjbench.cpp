@@ -0,0 +1,135 @@
+/* License and copyright go here*/
+
+/*
+ * Neighbourhood scan benchmark.
+ *
+ * Each tick, every monster looks at the 3x3 block around it for anyone
+ * to fight (as monsterAttacks() does). Compares the old way, copying
+ * each square's occupants out with monstersAt() into a std::map, with
+ * visiting the occupancy grid in place (grid::forEachAdjacent(), as
+ * level::forEachMonsterAdjacent() does) into a reused buffer.
+ *
+ * Reports the heap allocations and time per tick of each. Monsters are
+ * stand-ins with just an alignment, as the cost is all in the scan.
+ *
+ * usage: adjbench [monsters] [ticks]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <new>
+#include <random>
+#include <vector>
+#include "coord.hpp"
+#include "grid.hpp"
+#include "ref.hpp"
+
+static constexpr int W = 70, H = 20; // as level::MAX_WIDTH, MAX_HEIGHT
+
+// count every allocation made while counting_ is set
+static unsigned long allocations_ = 0;
+static bool counting_ = false;
+void *operator new(std::size_t size) {
+  if (counting_) ++allocations_;
+  void *p = std::malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+// (the library's operator delete frees with std::free, so needn't be replaced)
+
+struct mob {
+  int align_;
+};
+typedef grid<std::vector<mob *>, W, H> occupancy;
+
+// as level::monstersAt(): a fresh copy of the square's occupants
+std::vector<ref<mob> > monstersAt(const occupancy &o, const coord &c) {
+  std::vector<ref<mob> > rtn;
+  if (occupancy::contains(c))
+    for (mob *m : o[c]) rtn.emplace_back(*m);
+  return rtn;
+}
+
+// the old monsterAttacks() scan; returns how many neighbours are hostile
+unsigned int before(const occupancy &o, mob &me, const coord &pos) {
+  std::map<ref<mob>, coord> near;
+  for (int dx=-1; dx <= +1; ++dx)
+    for (int dy=-1; dy <= +1; ++dy) {
+      coord c(pos.first + dx, pos.second + dy);
+      auto m = monstersAt(o, c);
+      for (auto pM : m) near.emplace(pM, c);
+    }
+  unsigned int rtn = 0;
+  for (auto &n : near) {
+    const mob &en = n.first.value();
+    if (&en != &me && en.align_ != me.align_) ++rtn;
+  }
+  return rtn;
+}
+
+// the new one
+std::vector<std::pair<mob *, coord> > spare;
+unsigned int after(const occupancy &o, mob &me, const coord &pos) {
+  std::vector<std::pair<mob *, coord> > near;
+  near.swap(spare);
+  near.clear();
+  bool hostile = false;
+  o.forEachAdjacent(pos, [&me, &near, &hostile](const std::vector<mob *> &cell, const coord &c) {
+      for (mob *m : cell) {
+	if (m == &me) continue;
+	bool seen = false;
+	for (auto &n : near) if (n.first == m) seen = true;
+	if (seen) continue;
+	near.emplace_back(m, c);
+	if (m->align_ != me.align_) hostile = true;
+      }
+    });
+  unsigned int rtn = 0;
+  if (hostile)
+    for (auto &n : near)
+      if (n.first->align_ != me.align_) ++rtn;
+  near.swap(spare);
+  return rtn;
+}
+
+template <typename S>
+void run(const char *name, const occupancy &o, std::vector<mob> &mobs,
+	 const std::vector<coord> &pos, const unsigned int ticks, S scan) {
+  unsigned long found = 0;
+  scan(o, mobs[0], pos[0]); // warm up (the reused buffer)
+  allocations_ = 0;
+  counting_ = true;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned int t = 0; t < ticks; ++t)
+    for (size_t i = 0; i < mobs.size(); ++i)
+      found += scan(o, mobs[i], pos[i]);
+  std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+  counting_ = false;
+  std::cout << name << ": " << static_cast<double>(allocations_) / ticks << " allocations/tick, "
+	    << time.count() * 1e6 / ticks << "us/tick (" << found << " hostile sightings)" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  const unsigned int monsters = argc > 1 ? std::atoi(argv[1]) : 40;
+  const unsigned int ticks = argc > 2 ? std::atoi(argv[2]) : 10000;
+  std::default_random_engine gen(1);
+  std::uniform_int_distribution<int> x(0, W-1), y(0, H-1), align(0, 2);
+
+  // scatter the monsters; a few share squares
+  occupancy o;
+  std::vector<mob> mobs(monsters);
+  std::vector<coord> pos;
+  for (auto &m : mobs) {
+    m.align_ = align(gen);
+    pos.emplace_back(x(gen), y(gen));
+    o[pos.back()].push_back(&m);
+  }
+
+  std::cout << monsters << " monsters on a " << W << "x" << H << " level, "
+	    << ticks << " ticks" << std::endl;
+  run("monstersAt + map", o, mobs, pos, ticks, before);
+  run("forEachAdjacent", o, mobs, pos, ticks, after);
+  return 0;
+}
@@ -0,0 +1,57 @@
+/* License and copyright go here*/
+
+/*
+ * Random item generation benchmark.
+ *
+ * Makes random items at every depth of the dungeon, as the level
+ * generators and shops do while a new dungeon is created, and reports
+ * how many createRndItem() manages per second, and the share of each
+ * kind of item, so that changes to the generator can be checked for
+ * both speed and odds.
+ *
+ * usage: itembench [items per depth] [seed]
+ *
+ * NB: The game objects are built without optimisation, so only compare
+ * figures from the same build.
+ */
+
+#include <chrono>
+#include <clocale>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include "items.hpp"
+#include "itemholder.hpp"
+#include "random.hpp"
+#include "renderable.hpp"
+
+int main(int argc, char **argv) {
+  const int perDepth = argc > 1 ? std::stoi(argv[1]) : 2000;
+  seedRandom(argc > 2 ? std::stoull(argv[2]) : 20161018);
+  renderable::all();
+  setlocale(LC_ALL, ""); // item symbols aren't all ASCII
+
+  std::map<wchar_t, unsigned long> kinds;
+  unsigned long made = 0;
+  std::chrono::duration<double> time = std::chrono::duration<double>::zero();
+  for (int depth = 1; depth <= 100; ++depth) {
+    itemHolder h;
+    for (int n = 0; n < perDepth; ++n) {
+      auto t0 = std::chrono::steady_clock::now();
+      item &i = createRndItem(depth);
+      time += std::chrono::steady_clock::now() - t0;
+      ++made;
+      ++kinds[i.render()];
+      h.addItem(i);
+      h.destroyItem(i);
+    }
+  }
+
+  std::wcout << made << L" items over depths 1-100 in " << time.count() << L"s: "
+	     << std::fixed << std::setprecision(0) << made / time.count() << L" items/s"
+	     << std::endl << std::setprecision(1);
+  for (auto &k : kinds)
+    std::wcout << L"  " << k.first << L' ' << std::setw(5) << 100.0 * k.second / made << L'%' << std::endl;
+  return 0;
+}
@@ -0,0 +1,196 @@
+/* License and copyright go here*/
+
+/*
+ * Route-finding benchmark and correctness check.
+ *
+ * Lays out a corpus of maps with each of the standard level generators,
+ * then for random start/goal pairs compares each route-finder against
+ * an exact breadth-first oracle. Each finder is asked for one step at a
+ * time, as monsters do, and followed until it arrives, sticks or wanders.
+ *
+ * usage: pathbench [maps per generator] [queries per map]
+ *
+ * NB: The level generators use their own unseeded random numbers, so the
+ * corpus differs from run to run; the queries over it are seeded.
+ */
+
+#include <array>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+#include "coord.hpp"
+#include "level.hpp"
+#include "levelFactory.hpp"
+#include "terrain.hpp"
+#include "pathfinder.hpp"
+#include "astar.hpp"
+#include "distanceMap.hpp"
+
+static constexpr int W = level::MAX_WIDTH, H = level::MAX_HEIGHT;
+static constexpr int window = 12; // as used by monsters in mobile.cpp
+
+// one laid-out level, as a passability mask for an ordinary walking monster
+class map {
+private:
+  std::vector<bool> pass_;
+public:
+  std::vector<coord> open_;
+  explicit map(const std::vector<terrainType> &terrain) :
+    pass_(terrain.size()), open_() {
+    for (size_t i = 0; i < terrain.size(); ++i) {
+      switch (terrain[i]) {
+      case terrainType::ROCK: case terrainType::BULKHEAD: case terrainType::KNOTWEED:
+      case terrainType::WATER: case terrainType::SPACE: case terrainType::FIRE:
+      case terrainType::PIT: case terrainType::WEB:
+	break;
+      default:
+	pass_[i] = true;
+	open_.emplace_back(i % W, i / W);
+      }
+    }
+  }
+  bool operator()(const coord &c) const {
+    return c.first >= 0 && c.second >= 0 && c.first < W && c.second < H &&
+      pass_[c.first + c.second * W];
+  }
+};
+
+struct query {
+  coord start_, goal_;
+  unsigned short optimal_; // from the oracle
+};
+
+// totals for one route-finder over one generator
+struct result {
+  unsigned long queries_ = 0, steps_ = 0, probes_ = 0, expansions_ = 0;
+  unsigned long arrived_ = 0, optimal_ = 0, stuck_ = 0, reachable_ = 0;
+  std::chrono::duration<double> time_ = std::chrono::duration<double>::zero();
+};
+
+/*
+ * Follow a finder from start to goal, one step at a time.
+ * step(here, goal) - returns the direction to move.
+ * Gives up if we stand still, walk into a wall or take far too long.
+ */
+template <typename S>
+void follow(const map &m, const query &q, S step, result &r) {
+  ++r.queries_;
+  const bool reachable = q.optimal_ != distanceMap<W,H>::unreachable;
+  if (reachable) ++r.reachable_;
+  const unsigned long limit = reachable ? 2u * q.optimal_ + window : window;
+  coord here = q.start_;
+  unsigned long steps = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  while (here != q.goal_ && steps < limit) {
+    const dir d = step(here, q.goal_);
+    const coord next(here.first + d.first, here.second + d.second);
+    ++r.steps_;
+    if (next == here || !m(next)) break;
+    here = next;
+    ++steps;
+  }
+  r.time_ += std::chrono::steady_clock::now() - t0;
+  if (here == q.goal_) {
+    ++r.arrived_;
+    if (steps == q.optimal_) ++r.optimal_;
+  } else if (!reachable && steps < limit) ++r.stuck_; // correctly gave up
+}
+
+static void report(const std::wstring &gen, const std::wstring &finder, const result &r) {
+  auto pc = [](unsigned long n, unsigned long d) { return d == 0 ? 0.0 : 100.0 * n / d; };
+  std::wcout << std::left << std::setw(12) << gen << std::setw(12) << finder << std::right
+	     << std::fixed << std::setprecision(0)
+	     << std::setw(11) << (r.time_.count() > 0 ? r.steps_ / r.time_.count() : 0)
+	     << std::setprecision(1)
+	     << std::setw(9) << (r.steps_ ? double(r.probes_) / r.steps_ : 0)
+	     << std::setw(9) << (r.steps_ ? double(r.expansions_) / r.steps_ : 0)
+	     << std::setw(9) << pc(r.optimal_, r.reachable_)
+	     << std::setw(9) << pc(r.arrived_, r.reachable_)
+	     << std::setw(9) << pc(r.queries_ - r.reachable_, r.queries_)
+	     << std::setw(9) << pc(r.stuck_, r.queries_ - r.reachable_)
+	     << std::endl;
+}
+
+int main(int argc, char **argv) {
+  const int maps = argc > 1 ? std::stoi(argv[1]) : 20;
+  const int queries = argc > 2 ? std::stoi(argv[2]) : 50;
+  std::mt19937 rnd(20161018);
+
+  const std::array<std::pair<layoutKey, const wchar_t *>, 5> gens = {{
+      { layoutKey::ROOM, L"roomGen" },
+      { layoutKey::LABY, L"labyGen" },
+      { layoutKey::LABY_ROOM, L"labyRoomGen" },
+      { layoutKey::LABY_SMALL, L"labySmall" },
+      { layoutKey::WATER, L"water" } }};
+
+  std::wcout << L"Route-finding: " << maps << L" maps per generator, " << queries
+	     << L" queries per map (half within " << window << L" squares)." << std::endl
+	     << L"steps/s: finder calls per second; probes, expanded: per call;" << std::endl
+	     << L"optimal, arrived: % of reachable goals; no path: % of queries;" << std::endl
+	     << L"gave up: % of unreachable goals abandoned without wandering." << std::endl
+	     << std::endl
+	     << L"generator   finder          steps/s   probes expanded  optimal  arrived  no path  gave up"
+	     << std::endl;
+
+  astar<window> as;
+  distanceMap<W,H> oracle, flow;
+
+  for (auto &g : gens) {
+    result brute, star, flows;
+    for (int i = 0; i < maps; ++i) {
+      std::vector<terrainType> t;
+      try {
+	t = layoutLevel(g.first, i + 1);
+      } catch (char const *) {
+	--i; // labyrinth generation failed; try again
+	continue;
+      }
+      const map m(t);
+      if (m.open_.size() < 2) continue;
+      std::uniform_int_distribution<size_t> pick(0, m.open_.size() - 1);
+      for (int j = 0; j < queries; ++j) {
+	query q;
+	q.goal_ = m.open_[pick(rnd)];
+	int tries = 0;
+	do {
+	  q.start_ = m.open_[pick(rnd)];
+	} while (q.start_ == q.goal_ ||
+		 (j % 2 == 0 && ++tries < 1000 && q.start_.linearDistance(q.goal_) > window));
+	oracle.build(&q.goal_, &q.goal_ + 1, m);
+	q.optimal_ = oracle[q.start_];
+
+	unsigned long probes = 0;
+	auto counted = [&m, &probes](const coord &c) { ++probes; return m(c); };
+
+	pathfinder<window> pf(counted);
+	probes = 0;
+	follow(m, q, [&pf](const coord &s, const coord &e) { return pf.find(s, e); }, brute);
+	brute.probes_ += probes;
+
+	probes = 0;
+	follow(m, q, [&](const coord &s, const coord &e) {
+	    const dir d = as.find(s, e, counted);
+	    star.expansions_ += as.expansions();
+	    return d;
+	  }, star);
+	star.probes_ += probes;
+
+	// one fill per goal, shared by every step (as towardsPlayer() shares one per turn)
+	probes = 0;
+	auto t0 = std::chrono::steady_clock::now();
+	flow.build(&q.goal_, &q.goal_ + 1, counted);
+	flows.time_ += std::chrono::steady_clock::now() - t0;
+	follow(m, q, [&flow](const coord &s, const coord &e) { return flow.downhill(s, dir(e.first - s.first, e.second - s.second)); }, flows);
+	flows.probes_ += probes;
+      }
+    }
+    report(g.second, L"pathfinder", brute);
+    report(g.second, L"astar", star);
+    report(g.second, L"distanceMap", flows);
+  }
+  return 0;
+}
@@ -0,0 +1,112 @@
+/* License and copyright go here*/
+
+/*
+ * Monster scan check.
+ *
+ * Starts a game (character generation is answered from a pipe, with all
+ * the defaults), adds a crowd to each level the player reaches, then
+ * ticks, with the player taking a random step every tick and going down
+ * the stairs and back up every so often; the player is healed every
+ * tick, and a ghost, so the crowd can't end the game. Counts every walk over all the
+ * monsters on a level, and every failed lookup of a monster.
+ *
+ * Each tick walks its level's monsters once, and forEachMonster() walks
+ * them for whoever asks (a siren singing to the whole level, say).
+ * Before levels kept a reverse index, pcPos() walked them again for
+ * every monster that moved, and anyCoaligned() for every monster that
+ * looked for company. Fails if there are any walks besides those.
+ *
+ * Needs level.cpp built with COUNT_MONSTER_SCANS; the Makefile does so.
+ *
+ * usage: scancheck [ticks] [seed] [crowd]
+ */
+
+#include <clocale>
+#include <cstdio>
+#include <iostream>
+#include <set>
+#include <string>
+#include <unistd.h>
+#include "args.hpp"
+#include "dungeon.hpp"
+#include "monster.hpp"
+#include "monsterType.hpp"
+#include "output.hpp"
+#include "random.hpp"
+#include "renderable.hpp"
+#include "terrain.hpp"
+#include "time.hpp"
+
+// add n random monsters to l, on open ground
+void crowd(level &l, int n) {
+  const std::vector<coord> ground = l.findAllTerrain(terrainType::GROUND);
+  for (int i = 0; i < n && !ground.empty(); ++i)
+    l.addMonster(rndSolidMonster().spawn(l), *rndPick(ground.begin(), ground.end()));
+}
+
+int main(int argc, char **argv) {
+  const unsigned long ticks = argc > 1 ? std::stoul(argv[1]) : 1000;
+  seedRandom(argc > 2 ? std::stoull(argv[2]) : 20161018);
+  const int numCrowd = argc > 3 ? std::stoi(argv[3]) : 40;
+  renderable::all();
+  setlocale(LC_ALL, "");
+
+  // give a name, then take the default at every other prompt, and keep the screen out of the way:
+  int keys[2];
+  if (::pipe(keys) != 0) return 2;
+  const std::string enter = "bench\n" + std::string(200, '\n');
+  if (::write(keys[1], enter.c_str(), enter.size()) < 0) return 2;
+  ::close(keys[1]);
+  ::dup2(keys[0], 0);
+  std::FILE *screen = std::freopen("/dev/null", "w", stdout);
+  if (!screen) return 2;
+
+  const char *noArgs[] = { argv[0] };
+  auto io = ioFactory().create(args(1, noArgs));
+  unsigned long done = 0, levelTicks = 0, scans = 0, visits = 0, misses = 0, stairs = 0;
+  size_t monsters = 0;
+  {
+    dungeon d;
+    monster &pc = *d.pc();
+    pc.mutate(mutationType::GHOST); // most attacks pass through
+    std::set<level *> crowded;
+    int depth = 1;
+    const unsigned long scans0 = level::monsterScans(), visits0 = level::monsterVisits(),
+      misses0 = level::rosterMisses();
+    const unsigned long long start = time::moveCount();
+    for (; done < ticks && d.alive(); ++done) {
+      level &l = d.cur_level();
+      if (crowded.insert(&l).second) {
+	crowd(l, numCrowd);
+	l.forEachMonster([&monsters](monster &m) { if (!m.isPlayer()) ++monsters; });
+      }
+      if (done % 50 == 49) {
+	// down, or back up if we went down last time:
+	const bool down = depth == 1 || (stairs % 2) == 0;
+	l.moveTo(down ? terrainType::DOWN : terrainType::UP);
+	if (down) l.down(pc); else l.up(pc);
+	if (&d.cur_level() != &l) {
+	  depth += down ? 1 : -1;
+	  ++stairs;
+	}
+      } else {
+	const std::vector<int> step({-1, 0, +1});
+	l.move(pc, dir(*rndPick(step.begin(), step.end()), *rndPick(step.begin(), step.end())), true);
+      }
+      pc.injury() = 0u;
+      time::tick(true);
+    }
+    levelTicks = time::moveCount() - start; // the game takes some time of its own, eg on the stairs
+    scans = level::monsterScans() - scans0;
+    visits = level::monsterVisits() - visits0;
+    misses = level::rosterMisses() - misses0;
+  }
+  io.reset(); // restore the terminal before reporting
+
+  const long extra = static_cast<long>(scans) - levelTicks - visits;
+  std::wcerr << monsters << L" monsters, " << levelTicks << L" ticks, " << stairs << L" stairs: "
+	     << scans << L" monster scans, " << visits << L" of them by forEachMonster(), "
+	     << extra << L" others beyond the ticks' own; "
+	     << misses << L" lookups of monsters not there" << std::endl;
+  return extra == 0 ? 0 : 1;
+}
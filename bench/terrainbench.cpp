@@ -0,0 +1,125 @@
+/* License and copyright go here*/
+
+/*
+ * Terrain lookup benchmark.
+ *
+ * Lays out a few levels with the standard generators, then times the
+ * three terrain queries levels answer most: terrainAt(), findTerrain()
+ * and findAllTerrain(). Each is run against the old layout, a
+ * std::map<coord, terrain> walked in row-major order, and against the
+ * generated level itself, and reported as nanoseconds per call. The
+ * answers are cross-checked; the level's lists of positions have been
+ * reordered by every edit made while generating it.
+ *
+ * usage: terrainbench [levels] [calls per level]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "coord.hpp"
+#include "level.hpp"
+#include "levelFactory.hpp"
+#include "terrain.hpp"
+
+static constexpr int W = level::MAX_WIDTH, H = level::MAX_HEIGHT;
+
+// the layout before: a tree of terrain, looked up (and scanned) by coordinate
+class before {
+private:
+  std::map<coord, const terrain *> terrain_;
+public:
+  explicit before(const std::vector<terrainType> &t) : terrain_() {
+    for (int i = 0; i < W * H; ++i)
+      terrain_[coord(i % W, i / W)] = &tFactory.get(t[i]);
+  }
+  const terrain &terrainAt(const coord &c) const {
+    return *terrain_.at(c);
+  }
+  coord findTerrain(const terrainType &type) const {
+    for (coord c : coordRectIterator(0,0,W-1,H-1))
+      if (terrain_.at(c)->type() == type)
+	return c;
+    return coord(-1,-1);
+  }
+  std::vector<coord> findAllTerrain(const terrainType &type) const {
+    std::vector<coord> rtn;
+    for (coord c : coordRectIterator(0,0,W-1,H-1))
+      if (terrain_.at(c)->type() == type)
+	rtn.emplace_back(c);
+    return rtn;
+  }
+};
+
+// time calls to f(i) for i in [0, calls), returning ns/call
+template <typename F>
+double timeCalls(const unsigned long calls, F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < calls; ++i) f(i);
+  std::chrono::duration<double> t = std::chrono::steady_clock::now() - start;
+  return t.count() * 1e9 / calls;
+}
+
+int main(int argc, char **argv) {
+  const int levels = argc > 1 ? std::stoi(argv[1]) : 20;
+  const unsigned long calls = argc > 2 ? std::stoul(argv[2]) : 200000;
+  std::default_random_engine rnd(1);
+  std::uniform_int_distribution<int> x(0, W-1), y(0, H-1);
+  // what levels look for: ramps, somewhere to stand, and some rarities
+  const terrainType wanted[] = { terrainType::UP, terrainType::DOWN, terrainType::GROUND,
+				 terrainType::WATER, terrainType::ALTAR };
+  const size_t numWanted = sizeof(wanted) / sizeof(wanted[0]);
+
+  double at[2] = {0,0}, find[2] = {0,0}, all[2] = {0,0};
+  unsigned long sink = 0; // so the calls aren't optimised away
+  bool same = true; // cross-check of every answer
+  for (int l = 0; l < levels; ++l) {
+    std::unique_ptr<level> a;
+    try {
+      a = newLayoutLevel(l % 2 ? layoutKey::LABY : layoutKey::ROOM, l + 1);
+    } catch (char const *) {
+      --l; // labyrinth generation failed; try again
+      continue;
+    }
+    std::vector<terrainType> t;
+    for (coord c : coordRectIterator(0,0,W-1,H-1)) t.push_back(a->terrainAt(c).type());
+    const before b(t);
+    std::vector<coord> where;
+    for (unsigned long i = 0; i < calls; ++i) where.emplace_back(x(rnd), y(rnd));
+    // the level throws if it has none of a type, so only look for those it has
+    std::vector<terrainType> present;
+    for (auto w : wanted)
+      if (!a->findAllTerrain(w).empty()) present.push_back(w);
+
+    at[0] += timeCalls(calls, [&](unsigned long i) { sink += static_cast<size_t>(b.terrainAt(where[i]).type()); });
+    at[1] += timeCalls(calls, [&](unsigned long i) { sink += static_cast<size_t>(a->terrainAt(where[i]).type()); });
+    const unsigned long searches = calls / 100; // the old searches walk the whole map
+    find[0] += timeCalls(searches, [&](unsigned long i) { sink += b.findTerrain(present[i % present.size()]).first; });
+    find[1] += timeCalls(searches, [&](unsigned long i) { sink += a->findTerrain(present[i % present.size()]).first; });
+    all[0] += timeCalls(searches, [&](unsigned long i) { sink += b.findAllTerrain(wanted[i % numWanted]).size(); });
+    all[1] += timeCalls(searches, [&](unsigned long i) { sink += a->findAllTerrain(wanted[i % numWanted]).size(); });
+
+    for (auto w : present)
+      same = same && b.findTerrain(w) == a->findTerrain(w);
+    for (auto w : wanted) {
+      auto lhs = b.findAllTerrain(w), rhs = a->findAllTerrain(w);
+      std::sort(rhs.begin(), rhs.end(), [](const coord &p, const coord &q) {
+	  return p.second < q.second || (p.second == q.second && p.first < q.first);
+	});
+      same = same && lhs == rhs;
+    }
+  }
+
+  std::cout << levels << " levels" << (same ? "" : " (RESULTS DIFFER)") << std::endl;
+  const char *names[] = { "terrainAt", "findTerrain", "findAllTerrain" };
+  const double *times[] = { at, find, all };
+  for (int i = 0; i < 3; ++i)
+    std::cout << "  " << names[i] << ": " << times[i][0] / levels << "ns/call before, "
+	      << times[i][1] / levels << "ns/call after" << std::endl;
+  return sink != 0 && same ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+/* License and copyright go here*/
+
+/*
+ * Tick benchmark.
+ *
+ * Starts a game (character generation is answered from a pipe, with all
+ * the defaults), crowds the first level, then times level ticks with
+ * monster planning shared between 1, 2 and 4 threads. The player takes
+ * a random step every tick, so the routes to them keep changing, and is
+ * a ghost, healed every tick, so the crowd can't end the game.
+ *
+ * Each thread count runs in its own process, from the same seed, so
+ * they all play out the same game; the final positions are summed as a
+ * check that planning in parallel doesn't change it.
+ *
+ * usage: tickbench [ticks] [crowd] [seed]
+ */
+
+#include <chrono>
+#include <clocale>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "args.hpp"
+#include "dungeon.hpp"
+#include "monster.hpp"
+#include "monsterType.hpp"
+#include "output.hpp"
+#include "random.hpp"
+#include "renderable.hpp"
+#include "terrain.hpp"
+#include "time.hpp"
+
+// play out the game with the given number of planning threads; returns 0 on success
+int run(const unsigned int threads, const unsigned long ticks, const int numCrowd, const char *argv0) {
+  level::parallelPlanning(threads);
+
+  // give a name, then take the default at every other prompt, and keep the screen out of the way:
+  int keys[2];
+  if (::pipe(keys) != 0) return 2;
+  const std::string enter = "bench\n" + std::string(200, '\n');
+  if (::write(keys[1], enter.c_str(), enter.size()) < 0) return 2;
+  ::close(keys[1]);
+  ::dup2(keys[0], 0);
+  std::FILE *screen = std::freopen("/dev/null", "w", stdout);
+  if (!screen) return 2;
+
+  const char *noArgs[] = { argv0 };
+  auto io = ioFactory().create(args(1, noArgs));
+  unsigned long done = 0;
+  size_t monsters = 0;
+  long check = 0;
+  std::chrono::duration<double> elapsed(0);
+  {
+    dungeon d;
+    monster &pc = *d.pc();
+    pc.mutate(mutationType::GHOST); // most attacks pass through
+    level &l = d.cur_level();
+    const std::vector<coord> ground = l.findAllTerrain(terrainType::GROUND);
+    for (int i = 0; i < numCrowd; ++i)
+      l.addMonster(rndSolidMonster().spawn(l), *rndPick(ground.begin(), ground.end()));
+    l.forEachMonster([&monsters](monster &) { ++monsters; });
+
+    const std::vector<int> step({-1, 0, +1});
+    for (; done < ticks && d.alive() && &d.cur_level() == &l; ++done) {
+      l.move(pc, dir(*rndPick(step.begin(), step.end()), *rndPick(step.begin(), step.end())), true);
+      pc.injury() = 0u;
+      auto start = std::chrono::steady_clock::now();
+      time::tick(true);
+      elapsed += std::chrono::steady_clock::now() - start;
+    }
+    l.forEachMonster([&l, &check](monster &m) {
+	const coord c = l.posOf(m);
+	check += c.first * level::MAX_HEIGHT + c.second;
+      });
+  }
+  io.reset(); // restore the terminal before reporting
+
+  std::wcerr << threads << L" thread(s): " << monsters << L" monsters, " << done << L" ticks, "
+	     << (elapsed.count() * 1e6 / done) << L"us/tick (check " << check << L")" << std::endl;
+  return done == ticks ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+  const unsigned long ticks = argc > 1 ? std::stoul(argv[1]) : 300;
+  const int numCrowd = argc > 2 ? std::stoi(argv[2]) : 150;
+  const unsigned long long seed = argc > 3 ? std::stoull(argv[3]) : 20161018;
+  renderable::all();
+  setlocale(LC_ALL, "");
+
+  int rtn = 0;
+  for (unsigned int threads : { 1, 2, 4 }) {
+    const pid_t child = ::fork();
+    if (child < 0) return 2;
+    if (child == 0) {
+      seedRandom(seed);
+      return run(threads, ticks, numCrowd, argv[0]);
+    }
+    int status;
+    if (::waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) rtn = 1;
+  }
+  return rtn;
+}
@@ -0,0 +1,74 @@
+/* License and copyright go here*/
+
+/*
+ * Time callback microbenchmark.
+ *
+ * Registers 10,000 tick callbacks, then times dispatch, both with a
+ * fixed set of callbacks and with some callbacks unregistering and
+ * re-registering themselves during each tick (as monsters do when
+ * they die, fall asleep or wake up). Then checks that callbacks run in
+ * the order they were registered, even when one reuses a vacated slot.
+ *
+ * usage: timebench [ticks]
+ */
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "time.hpp"
+
+static constexpr int numCallbacks = 10000;
+
+static void report(const wchar_t *name, int ticks, unsigned long calls,
+		   std::chrono::duration<double> elapsed) {
+  std::wcout << name << L": " << ticks << L" ticks in " << elapsed.count() << L"s; "
+	     << (elapsed.count() * 1e9 / calls) << L"ns per callback" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  const int ticks = argc > 1 ? std::stoi(argv[1]) : 1000;
+  unsigned long calls = 0;
+  std::vector<std::unique_ptr<time::callback> > cbs;
+  cbs.reserve(numCallbacks);
+  for (int i = 0; i < numCallbacks; ++i)
+    cbs.emplace_back(new time::callback(true, [&calls]() { ++calls; }));
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < ticks; ++i)
+    time::tick(false);
+  report(L"static", ticks, calls, std::chrono::steady_clock::now() - t0);
+
+  // every 100th callback unregisters itself, then re-registers one of the others
+  cbs.clear();
+  calls = 0;
+  for (int i = 0; i < numCallbacks; ++i) {
+    if (i % 100 == 0)
+      cbs.emplace_back(new time::callback(true, [&calls, &cbs, i]() {
+	    ++calls;
+	    time::offTick(*cbs[i]);
+	    time::offTick(*cbs[i + 1]);
+	    time::onTick(*cbs[i + 1]);
+	    time::onTick(*cbs[i]);
+	  }));
+    else
+      cbs.emplace_back(new time::callback(true, [&calls]() { ++calls; }));
+  }
+  t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < ticks; ++i)
+    time::tick(false);
+  report(L"churn", ticks, calls, std::chrono::steady_clock::now() - t0);
+
+  // a, b and c register; a leaves and d takes its slot, but d must still run last
+  cbs.clear();
+  std::wstring order;
+  std::unique_ptr<time::callback> a(new time::callback(true, [&order]() { order += L'a'; }));
+  time::callback b(true, [&order]() { order += L'b'; });
+  time::callback c(true, [&order]() { order += L'c'; });
+  a.reset();
+  time::callback d(true, [&order]() { order += L'd'; });
+  time::tick(false);
+  std::wcout << L"order: " << order << (order == L"bcd" ? L"" : L" (expected bcd)") << std::endl;
+  return order == L"bcd" ? 0 : 1;
+}
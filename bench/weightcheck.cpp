@@ -0,0 +1,99 @@
+/* License and copyright go here*/
+
+/*
+ * Carried weight check.
+ *
+ * Starts a game (character generation is answered from a pipe, with all
+ * the defaults), gives the player some bottles, one of them in a poke,
+ * then repeatedly empties and refills them, checking after each change
+ * that the player's cached totalWeight() matches a fresh sum of what
+ * they carry. Bottles hold their contents through a private itemHolder,
+ * so this catches any change which doesn't reach the holder above.
+ *
+ * usage: weightcheck [rounds] [seed]
+ */
+
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "args.hpp"
+#include "dungeon.hpp"
+#include "items.hpp"
+#include "itemholder.hpp"
+#include "itemTypes.hpp"
+#include "output.hpp"
+#include "random.hpp"
+#include "renderable.hpp"
+
+// the weight of everything in h, ignoring any cached totals
+double freshWeight(const itemHolder &h) {
+  double rtn = 0;
+  h.forEachItem([&rtn](const item &i, std::wstring) { rtn += i.weight(); });
+  return rtn;
+}
+
+// the item in the given bottle, found through the items' holders rather than the bottle
+optionalRef<item> contentOf(const item &bottle) {
+  auto &map = itemHolderMap::instance();
+  return map.rndIf([&map, &bottle](item &i) {
+      auto h = map.holderOf(i);
+      return h && h->asItem() == &bottle;
+    });
+}
+
+int main(int argc, char **argv) {
+  const int rounds = argc > 1 ? std::stoi(argv[1]) : 100;
+  seedRandom(argc > 2 ? std::stoull(argv[2]) : 20161018);
+  renderable::all();
+  setlocale(LC_ALL, "");
+
+  // give a name, then take the default at every other prompt, and keep the screen out of the way:
+  int keys[2];
+  if (::pipe(keys) != 0) return 2;
+  const std::string enter = "bench\n" + std::string(200, '\n');
+  if (::write(keys[1], enter.c_str(), enter.size()) < 0) return 2;
+  ::close(keys[1]);
+  ::dup2(keys[0], 0);
+  std::FILE *screen = std::freopen("/dev/null", "w", stdout);
+  if (!screen) return 2;
+
+  const char *noArgs[] = { argv[0] };
+  auto io = ioFactory().create(args(1, noArgs));
+  unsigned long checks = 0, stale = 0;
+  {
+    dungeon d;
+    monster &pc = *d.pc();
+    auto check = [&pc, &checks, &stale]() {
+      ++checks;
+      if (std::abs(pc.totalWeight() - freshWeight(pc)) > 1e-9) ++stale;
+    };
+
+    // each bottle, with its holder; we keep the holder, as it can't be found again once the bottle is empty
+    std::vector<std::pair<item *, itemHolder *> > bottles;
+    item &poke = createItem(itemTypeKey::poke);
+    pc.addItem(poke);
+    for (int i = 0; i < 4; ++i) {
+      item &b = createRndBottledItem(1);
+      bottles.emplace_back(&b, &contentOf(b).value().holder());
+      if (i == 0) dynamic_cast<itemHolder &>(poke).addItem(b);
+      else pc.addItem(b);
+    }
+    check();
+
+    for (int r = 0; r < rounds; ++r)
+      for (auto &b : bottles) {
+	auto content = contentOf(*b.first);
+	if (content) b.second->destroyItem(content.value()); // empty it
+	else b.second->addItem(createItem(itemTypeKey::water)); // fill it
+	check();
+      }
+  }
+  io.reset(); // restore the terminal before reporting
+
+  std::wcerr << checks << L" checks of carried weight: " << stale << L" stale" << std::endl;
+  return stale == 0 ? 0 : 1;
+}
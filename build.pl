@@ -47,7 +47,7 @@ for my $cfile (`ls src/*.cpp`) {
 
 # Output
 
-my $CXXFLAGS = "-Wall -std=c++11"; #-g
+my $CXXFLAGS = "-Wall -std=c++11 -pthread"; #-g
 
 print "# This is an auto-generated file. Please make changes in build.pl\n\n";
 print "CXX ?= c++\n\n"; 
@@ -0,0 +1,72 @@
+/* License and copyright go here*/
+
+// constant-time weighted random choice
+
+#ifndef ALIASTABLE_HPP
+#define ALIASTABLE_HPP
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * Walker's alias method: pick one of n outcomes, each with its own
+ * (whole-number) weight, with a single 64-bit random number. Every slot
+ * of the table holds at most two outcomes, its own and an alias, so a
+ * draw is one slot plus one comparison, however uneven the weights.
+ *
+ * The top 32 bits of the draw choose the slot and the bottom 32 the
+ * outcome within it; weights are exact to about 1 in 2^32.
+ */
+class aliasTable {
+private:
+  // chance (out of 2^32) of keeping each slot's own outcome; 2^32 means always
+  std::vector<uint64_t> keep_;
+  std::vector<uint32_t> alias_;
+public:
+  aliasTable() : keep_(), alias_() {}
+
+  // weights must not all be zero, and should total less than 2^32
+  explicit aliasTable(const std::vector<uint64_t> &weights) :
+    keep_(weights.size()), alias_(weights.size()) {
+    const uint64_t n = weights.size();
+    uint64_t total = 0;
+    for (auto w : weights) total += w;
+    // scale each weight by n, so that the average slot holds exactly total:
+    std::vector<uint64_t> scaled(n);
+    std::vector<uint32_t> small, large;
+    for (uint32_t i = 0; i < n; ++i) {
+      scaled[i] = weights[i] * n;
+      alias_[i] = i;
+      (scaled[i] < total ? small : large).push_back(i);
+    }
+    // fill each under-full slot from an over-full one:
+    while (!small.empty() && !large.empty()) {
+      const uint32_t s = small.back(), l = large.back();
+      small.pop_back();
+      keep_[s] = (scaled[s] << 32) / total;
+      alias_[s] = l;
+      scaled[l] -= total - scaled[s];
+      if (scaled[l] < total) {
+	large.pop_back();
+	small.push_back(l);
+      }
+    }
+    // anything left is full (give or take rounding):
+    for (auto i : small) keep_[i] = 1ULL << 32;
+    for (auto i : large) keep_[i] = 1ULL << 32;
+  }
+
+  bool empty() const { return keep_.empty(); }
+  size_t size() const { return keep_.size(); }
+
+  // index of the chosen outcome; G must give 64 random bits
+  template <typename G>
+  uint32_t operator()(G &gen) const {
+    static_assert(G::min() == 0 && G::max() == UINT64_MAX, "aliasTable needs 64 random bits");
+    const uint64_t r = gen();
+    const uint32_t slot = static_cast<uint32_t>(((r >> 32) * keep_.size()) >> 32);
+    return (r & 0xffffffffULL) < keep_[slot] ? slot : alias_[slot];
+  }
+};
+
+#endif //ndef ALIASTABLE_HPP
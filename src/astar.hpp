@@ -0,0 +1,149 @@
+/* License and copyright go here*/
+
+// A* path finding over the level grid
+
+#ifndef ASTAR_HPP
+#define ASTAR_HPP
+
+#include <array>
+#include <vector>
+#include <algorithm> // push_heap, pop_heap
+#include <cstdlib> // abs
+#include "coord.hpp" // coordinates
+
+/*
+ * A* search in a square window centred on the start position, using
+ * an octile heuristic. A move costs the same in any direction, so
+ * diagonals carry only a tiny extra cost; enough to prefer the
+ * straighter of two equally short routes.
+ *
+ * The workspace is allocated once and reused for each call, so keep
+ * an instance around rather than creating one per search. The
+ * passability test is a template parameter, so lambdas are inlined
+ * rather than called through a std::function; each square is tested
+ * at most once per search.
+ *
+ * maxDistance - how far (in moves) from the start we consider. If the
+ * target is further away, or can't be reached, we head for the square
+ * we found which is nearest to it.
+ */
+template<int maxDistance>
+class astar {
+private:
+  static constexpr int gridsize = 2*maxDistance+1;
+  static constexpr int cells = gridsize * gridsize;
+  static constexpr unsigned int straight = 1024, diagonal = straight + 1;
+  enum class state : unsigned char { unseen, open, closed, blocked };
+  // best known cost from the start
+  std::array<unsigned int, cells> cost_;
+  // offset of the previous square on the best known route
+  std::array<short, cells> parent_;
+  std::array<state, cells> state_;
+  // which search last wrote each square; saves clearing the arrays each time
+  std::array<unsigned int, cells> stamp_;
+  unsigned int search_;
+  // open list, as a binary heap of (estimated total cost, offset)
+  std::vector<std::pair<unsigned int, short> > open_;
+  // how many squares were expanded by the last search
+  unsigned int expansions_;
+
+  // relative coordinates to offsets into the workspace; start is the middle
+  static int index(const int dx, const int dy) {
+    return (dy + maxDistance) * gridsize + dx + maxDistance;
+  }
+  static coord rel(const int idx) {
+    return coord(idx % gridsize - maxDistance, idx / gridsize - maxDistance);
+  }
+  static unsigned int octile(const coord &a, const coord &b) {
+    const unsigned int dx = std::abs(a.first - b.first), dy = std::abs(a.second - b.second);
+    return dx < dy ?
+      diagonal * dx + straight * (dy - dx) :
+      diagonal * dy + straight * (dx - dy);
+  }
+public:
+  astar() :
+    cost_(), parent_(), state_(), stamp_(), search_(0), open_(), expansions_(0) {
+    open_.reserve(cells);
+  }
+  astar(const astar &) = delete;
+  astar &operator=(const astar &) = delete;
+
+  /*
+   * start - where are we?
+   * end - where do we want to go?
+   * pass - functor; can we stand on the given square?
+   * returns direction to head in
+   */
+  template <typename P>
+  dir find(const coord &start, const coord &end, P pass) {
+    expansions_ = 0;
+    if (start == end) return dir(0,0);
+    if (++search_ == 0) { // wrapped; forget everything
+      stamp_.fill(0);
+      search_ = 1;
+    }
+    open_.clear();
+    auto greater = [](const std::pair<unsigned int, short> &a, const std::pair<unsigned int, short> &b) {
+      return a.first > b.first;
+    };
+
+    const int origin = index(0,0);
+    stamp_[origin] = search_;
+    state_[origin] = state::open;
+    cost_[origin] = 0;
+    parent_[origin] = origin;
+    open_.emplace_back(octile(start, end), origin);
+
+    // nearest square to the target found so far, in case we can't get there:
+    int best = origin;
+    unsigned int bestH = octile(start, end);
+
+    while (!open_.empty()) {
+      std::pop_heap(open_.begin(), open_.end(), greater);
+      const int cur = open_.back().second;
+      open_.pop_back();
+      if (state_[cur] == state::closed) continue; // stale entry; already reached more cheaply
+      state_[cur] = state::closed;
+      ++expansions_;
+
+      const coord r = rel(cur);
+      const coord here(start.first + r.first, start.second + r.second);
+      const unsigned int h = octile(here, end);
+      if (h < bestH) { best = cur; bestH = h; }
+      if (h == 0) break; // arrived
+
+      for (int dy = -1; dy <= 1; ++dy)
+	for (int dx = -1; dx <= 1; ++dx) {
+	  if (dx == 0 && dy == 0) continue;
+	  const int nx = r.first + dx, ny = r.second + dy;
+	  if (nx < -maxDistance || nx > maxDistance || ny < -maxDistance || ny > maxDistance)
+	    continue; // outside the search window
+	  const int n = index(nx, ny);
+	  if (stamp_[n] != search_) {
+	    stamp_[n] = search_;
+	    state_[n] = pass(coord(start.first + nx, start.second + ny)) ? state::unseen : state::blocked;
+	  }
+	  if (state_[n] == state::blocked || state_[n] == state::closed) continue;
+	  const unsigned int c = cost_[cur] + (dx != 0 && dy != 0 ? diagonal : straight);
+	  if (state_[n] == state::open && c >= cost_[n]) continue;
+	  cost_[n] = c;
+	  parent_[n] = cur;
+	  state_[n] = state::open;
+	  open_.emplace_back(c + octile(coord(start.first + nx, start.second + ny), end), n);
+	  std::push_heap(open_.begin(), open_.end(), greater);
+	}
+    }
+
+    // walk back from the best square to find the first step:
+    if (best == origin) return dir(0,0); // can't move any closer
+    while (parent_[best] != origin)
+      best = parent_[best];
+    const coord step = rel(best);
+    return dir(step.first, step.second);
+  }
+
+  // squares expanded by the most recent find()
+  unsigned int expansions() const { return expansions_; }
+};
+
+#endif //ndef ASTAR_HPP
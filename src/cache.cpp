@@ -0,0 +1,26 @@
+/* License and copyright go here*/
+
+// simple caching of derived data, with usage counts
+
+#include "cache.hpp"
+#include <vector>
+
+// function-local, so it exists before any static cacheStats registers with it
+static std::vector<const cacheStats *> &allStats() {
+  static std::vector<const cacheStats *> all;
+  return all;
+}
+
+cacheStats::cacheStats(const wchar_t * const name) :
+  name_(name), hits_(0), misses_(0) {
+  allStats().push_back(this);
+}
+
+void cacheStats::report(std::wostream &out) {
+  for (auto s : allStats()) {
+    const unsigned long total = s->hits_ + s->misses_;
+    out << s->name_ << L": " << s->hits_ << L" hits, " << s->misses_ << L" misses";
+    if (total > 0) out << L" (" << (100 * s->hits_ / total) << L"% hit rate)";
+    out << std::endl;
+  }
+}
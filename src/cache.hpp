@@ -0,0 +1,69 @@
+/* License and copyright go here*/
+
+// simple caching of derived data, with usage counts
+
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+#include <ostream>
+
+/*
+ * Hit and miss counts for one kind of cache, shared by all its
+ * instances. Each kind registers itself on construction, so report()
+ * can tell us whether the caches are earning their keep in a long game.
+ */
+class cacheStats {
+private:
+  const wchar_t * const name_;
+  unsigned long hits_;
+  unsigned long misses_;
+public:
+  explicit cacheStats(const wchar_t * const name);
+  cacheStats(const cacheStats &) = delete;
+  cacheStats &operator=(const cacheStats &) = delete;
+  void hit() { ++hits_; }
+  void miss() { ++misses_; }
+  unsigned long hits() const { return hits_; }
+  unsigned long misses() const { return misses_; }
+  // output the counts for every kind of cache
+  static void report(std::wostream &out);
+};
+
+/*
+ * A value derived from something that changes occasionally (typically
+ * the terrain of a level), along with the key it was derived from,
+ * usually a generation counter. The value is recalculated only when
+ * the key changes or the cache is invalidated.
+ */
+template <typename T, typename K = unsigned long>
+class generationCache {
+private:
+  bool valid_;
+  K key_;
+  T value_;
+public:
+  generationCache() :
+    valid_(false), key_(), value_() {}
+  // return the value for the given key, calling recalc(T&) to update it first if needed.
+  template <typename F>
+  T &get(const K &key, cacheStats &stats, F recalc) {
+    if (valid_ && key == key_) {
+      stats.hit();
+    } else {
+      stats.miss();
+      recalc(value_);
+      key_ = key;
+      valid_ = true;
+    }
+    return value_;
+  }
+  // as above, for caches which are only ever invalidated explicitly
+  template <typename F>
+  T &get(cacheStats &stats, F recalc) {
+    return get(key_, stats, recalc);
+  }
+  // force a recalculation on the next get()
+  void invalidate() { valid_ = false; }
+};
+
+#endif //ndef CACHE_HPP
@@ -4,7 +4,7 @@
 
 #include "coord.hpp"
 
-#include <random>
+#include "random.hpp"
 
 std::ostream & operator << (std::ostream & out, const coord & c) {
   out << '(' << c.first << ',' << c.second << ')';
@@ -16,7 +16,6 @@ std::wostream & operator << (std::wostream & out, const coord & c) {
   return out;
 }
 
-static std::default_random_engine generator; // random.cpp
 
 /*
  * Pick a random value matching f.
@@ -0,0 +1,93 @@
+/* License and copyright go here*/
+
+// breadth-first distance fields over the level grid
+
+#ifndef DISTANCEMAP_HPP
+#define DISTANCEMAP_HPP
+
+#include <climits>
+#include <vector>
+#include "coord.hpp"
+#include "grid.hpp"
+
+/*
+ * For each square of a W*H map, the number of moves to the nearest of
+ * a set of source squares. Built with one breadth-first fill, so any
+ * number of monsters heading for the same place can share it, each
+ * just stepping to its lowest-valued neighbour.
+ */
+template <int W, int H>
+class distanceMap {
+public:
+  static constexpr unsigned short unreachable = USHRT_MAX;
+private:
+  typedef grid<unsigned short, W, H> grid_t;
+  grid_t dist_;
+  // BFS queue of offsets; kept to avoid reallocating on each build
+  std::vector<int> queue_;
+public:
+  distanceMap() :
+    dist_(unreachable), queue_() {
+    queue_.reserve(grid_t::size);
+  }
+
+  /*
+   * Fill the map from all the given sources.
+   * pass - functor; can we step onto the given (on-map) square?
+   * Sources are always distance 0, passable or not.
+   */
+  template <typename I, typename P>
+  void build(I begin, const I end, P pass) {
+    dist_.fill(unreachable);
+    queue_.clear();
+    for (; begin != end; ++begin) {
+      const coord &c = *begin;
+      if (!grid_t::contains(c) || dist_[c] == 0) continue;
+      dist_[c] = 0;
+      queue_.push_back(grid_t::index(c));
+    }
+    for (size_t head = 0; head < queue_.size(); ++head) {
+      const coord c = grid_t::coordOf(queue_[head]);
+      const unsigned short d = dist_[c] + 1;
+      for (int dy = -1; dy <= 1; ++dy)
+	for (int dx = -1; dx <= 1; ++dx) {
+	  const coord n(c.first + dx, c.second + dy);
+	  if (!grid_t::contains(n) || dist_[n] != unreachable) continue;
+	  if (!pass(n)) continue;
+	  dist_[n] = d;
+	  queue_.push_back(grid_t::index(n));
+	}
+    }
+  }
+
+  // moves from c to the nearest source, or unreachable
+  unsigned short operator[](const coord &c) const {
+    return grid_t::contains(c) ? dist_[c] : unreachable;
+  }
+
+  /*
+   * Which way should we step from c to get closer to a source?
+   * Where several neighbours are equally close, prefer is taken if it
+   * is one of them, so monsters still head roughly straight for their
+   * goal. Returns dir(0,0) if there is no way to get closer.
+   */
+  dir downhill(const coord &c, const dir &prefer = dir(0,0)) const {
+    unsigned short best = (*this)[c];
+    dir rtn(0,0);
+    for (int dy = -1; dy <= 1; ++dy)
+      for (int dx = -1; dx <= 1; ++dx) {
+	if (dx == 0 && dy == 0) continue;
+	const unsigned short d = (*this)[coord(c.first + dx, c.second + dy)];
+	if (d < best || (d == best && !(rtn == dir(0,0)) && prefer == dir(dx, dy))) {
+	  best = d;
+	  rtn = dir(dx, dy);
+	}
+      }
+    return rtn;
+  }
+};
+
+template <int W, int H>
+constexpr unsigned short distanceMap<W, H>::unreachable;
+
+#endif //ndef DISTANCEMAP_HPP
@@ -12,12 +12,13 @@
 #include <sstream>
 
 const int NUM_LEVELS = 100;
-int dPc(); // defined in random.cpp
 
 // initialise the dungeon:
 dungeon::dungeon() 
   : alive_(true),
-    cur_level_(1) {
+    cur_level_(1),
+    player_(),
+    ticker_(true, [this]() { cur_level().tick(); }) {
   // NB: Dependency order provides some oddities here.
   // player needs a level, and level needs a level factory, and level
   // factory needs a role (to build role-specific levels).
@@ -27,15 +28,10 @@ dungeon::dungeon()
   // TODO: should level be passed separately to monsterbuilder for further decoupling?
   playerBuilder pb = chargen();
 
-  levelFactory factory(*this, NUM_LEVELS, pb.job());
-  for (auto l : factory) {
-    level_.emplace_back(l);
-    auto pL = level_.rbegin()->get();
-    if (pL->depth() > 50 && dPc() < pL->depth() - 50)
-      pL->crack();
-  }
+  // levels are only built as they're needed:
+  level_.reset(new levelFactory(*this, NUM_LEVELS, pb.job()));
 
-  level &start = *(level_[cur_level_]);
+  level &start = cur_level();
   pb.startOn(start);
   player_ = std::shared_ptr<player> (new player(pb));
   // player starts on level 1, NOT the first level:
@@ -44,6 +40,7 @@ dungeon::dungeon()
   // welcome message
   ioFactory::instance().message(player_->job().startGameMessage());
   announceLevel();
+  buildNeighbours();
 }
 
 dungeon::~dungeon() {
@@ -62,34 +59,50 @@ const std::shared_ptr<player>  dungeon::pc() const {
 }
 
 int dungeon::maxLevel() const {
-  return level_.size() -1;
+  return level_->numLevels();
 }
 
 level & dungeon::operator[](const unsigned char &i) {
-  return *level_[i];
+  return (*level_)[i];
 }
 
 const level & dungeon::operator[](const unsigned char &i) const {
-  return *level_[i];
+  return (*level_)[i];
 }
 
 
 void dungeon::announceLevel() {
-  ioFactory::instance().message(L"You find yourself in: " + level_[cur_level_]->name());
+  ioFactory::instance().message(L"You find yourself in: " + cur_level().name());
 }
 
 void dungeon::upLevel() {
   if (cur_level_ < 0) throw L"at top"; // already checked in level{}
   cur_level_--;
-  level_[cur_level_]->addMonster(pc(), level_[cur_level_]->findTerrain(terrainType::DOWN));
+  cur_level().addMonster(pc(), cur_level().findTerrain(terrainType::DOWN));
   announceLevel();
+  buildNeighbours();
 }
 
 void dungeon::downLevel() {
   if (cur_level_ >= maxLevel()) throw L"at bottom"; // already checked in level{}
   cur_level_++;
-  level_[cur_level_]->addMonster(pc(), level_[cur_level_]->findTerrain(terrainType::UP));
+  cur_level().addMonster(pc(), cur_level().findTerrain(terrainType::UP));
   announceLevel();
+  buildNeighbours();
+}
+
+void dungeon::buildNeighbours() {
+  level_->buildAhead(cur_level_ + 1);
+  level_->buildAhead(cur_level_ - 1);
+}
+
+dungeon::idle::idle(dungeon &d) :
+  dungeon_(d) {
+  dungeon_.level_->beginIdle();
+}
+
+dungeon::idle::~idle() {
+  dungeon_.level_->endIdle();
 }
 
 void dungeon::quit() {
@@ -105,7 +118,7 @@ bool dungeon::alive() const {
 };
 
 void dungeon::interrogate() const {
-  auto &l = *level_[cur_level_];
+  auto &l = cur_level();
   ioFactory::instance().interrogate(l, l.pcPos());
 }
 
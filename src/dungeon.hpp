@@ -17,11 +17,25 @@ class io;
 class dungeon {
 private:
   bool alive_;
-  ::std::vector<std::unique_ptr<level> > level_; //[NUM_LEVELS+1]; // 0 not used for now; may choose to do something with it later
+  ::std::unique_ptr<levelFactory> level_; //[NUM_LEVELS+1]; // 0 not used for now; may choose to do something with it later
   int cur_level_;
   ::std::shared_ptr<player> player_; // the hero of the game
+  ::time::callback ticker_; // runs the current level each tick; other levels lie dormant
   //  ::time::callback refresher_; // redraw on player move -> done in main loop instead, in case something registered later changes the screen
+  // ask for the levels either side of the current one to be built in the background
+  void buildNeighbours();
 public:
+  // while one exists, the game is waiting for the player, so levels may be built in the background
+  class idle {
+  private:
+    dungeon &dungeon_;
+  public:
+    explicit idle(dungeon &d);
+    idle(const idle &) = delete;
+    idle &operator=(const idle &) = delete;
+    ~idle();
+  };
+
   // create the dungeon.
   dungeon();
   dungeon(const dungeon &rhs) = delete;
@@ -32,8 +46,8 @@ public:
   // output the dungeon to the interface
   void draw () const;
   // access the current level
-  level & cur_level() { return *(level_[cur_level_]); }
-  const level & cur_level() const { return *(level_[cur_level_]); }
+  level & cur_level() { return (*level_)[cur_level_]; }
+  const level & cur_level() const { return (*level_)[cur_level_]; }
   // access the player
   std::shared_ptr<player> pc();
   const std::shared_ptr<player> pc() const;
@@ -41,7 +55,7 @@ public:
   formatter msg() const;
   int maxLevel() const;
 
-  // look ahead
+  // look ahead; NB: this builds the level if nobody has been there yet
   level & operator[](const unsigned char &);
   const level & operator[](const unsigned char &) const;
   
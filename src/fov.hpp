@@ -0,0 +1,91 @@
+/* License and copyright go here*/
+
+// field of view over the level grid
+
+#ifndef FOV_HPP
+#define FOV_HPP
+
+#include <bitset>
+#include "coord.hpp"
+
+/*
+ * Recursive shadowcasting over a W*H map: which squares can be seen
+ * from a given square, within a given number of moves? Each octant is
+ * scanned outwards a row at a time, and anything opaque casts a shadow
+ * over the rows behind it, so each visible square is visited about once
+ * and hidden ones hardly at all.
+ *
+ * Opaque squares themselves are visible (you can see a wall), as is the
+ * viewer's own square; anything off the map is neither.
+ */
+template <int W, int H>
+class fov {
+public:
+  // one bit per square, row-major (x + y * W); set where visible
+  typedef std::bitset<W * H> layer;
+private:
+  // transforms from octant coordinates (column, row) to map offsets (as xx, xy, yx, yy)
+  static constexpr int octants[8][4] = {
+    { 1,  0,  0,  1}, { 0,  1,  1,  0}, { 0, -1,  1,  0}, {-1,  0,  0,  1},
+    {-1,  0,  0, -1}, { 0, -1, -1,  0}, { 0,  1, -1,  0}, { 1,  0,  0, -1}
+  };
+
+  static bool contains(const int x, const int y) {
+    return x >= 0 && y >= 0 && x < W && y < H;
+  }
+
+  /*
+   * Light one octant from row outwards, between the start and end slopes
+   * (start > end). Rows are at distance row from the viewer; within a row,
+   * columns run from the start slope towards the end slope.
+   */
+  template <typename O>
+  static void scan(const coord &origin, const int radius, O &opaque, layer &seen,
+		   const int row, double start, const double end, const int *t) {
+    if (start < end) return;
+    double newStart = start;
+    for (int j = row; j <= radius; ++j) {
+      bool blocked = false;
+      for (int dx = -j, dy = -j; dx <= 0; ++dx) {
+	const double lSlope = (dx - 0.5) / (dy + 0.5), rSlope = (dx + 0.5) / (dy - 0.5);
+	if (start < rSlope) continue;
+	if (end > lSlope) break;
+	const int x = origin.first + dx * t[0] + dy * t[1],
+	  y = origin.second + dx * t[2] + dy * t[3];
+	const bool inside = contains(x, y);
+	if (inside) seen.set(x + y * W);
+	const bool wall = !inside || opaque(coord(x, y));
+	if (blocked) {
+	  if (wall) { newStart = rSlope; continue; }
+	  blocked = false;
+	  start = newStart;
+	} else if (wall && j < radius) {
+	  // this row is part-shadowed; light the unshadowed part of the rows behind first
+	  blocked = true;
+	  scan(origin, radius, opaque, seen, j + 1, start, lSlope, t);
+	  newStart = rSlope;
+	}
+      }
+      if (blocked) break;
+    }
+  }
+public:
+  /*
+   * Mark in seen every square visible from origin, up to radius moves
+   * away (in any direction, diagonals counting as one).
+   * opaque - functor; does the given (on-map) square block sight?
+   */
+  template <typename O>
+  static void cast(const coord &origin, const int radius, O opaque, layer &seen) {
+    seen.reset();
+    if (!contains(origin.first, origin.second)) return;
+    seen.set(origin.first + origin.second * W);
+    for (auto &t : octants)
+      scan(origin, radius, opaque, seen, 1, 1.0, 0.0, t);
+  }
+};
+
+template <int W, int H>
+constexpr int fov<W, H>::octants[8][4];
+
+#endif //ndef FOV_HPP
@@ -10,15 +10,18 @@
 #include "religion.hpp"
 #include "random.hpp"
 #include "itemTypes.hpp"
+#include <algorithm>
 
 // TODO: use this somewhere
 gardenZone::gardenZone(std::unique_ptr<geometry> &&geometry,
 		       level &lvl, bool hostile) :
-  geometry_(), hostile_(hostile), lvl_(lvl), callbacks_() {
+  geometry_(), hostile_(hostile), lvl_(lvl), timers_() {
   geometry_.swap(geometry);
 }
 
-gardenZone::~gardenZone() {}
+gardenZone::~gardenZone() {
+  for (auto &t : timers_) time::cancel(t);
+}
 
 bool gardenZone::contains(coord a) {
   return geometry_->contains(a);
@@ -70,8 +73,14 @@ bool gardenZone::onExit(monster &mon, itemHolder &next) {
       return false;
     }
 
-    if (lvl_.terrainAt(dest).type() == tType)
-      callbacks_.emplace_back(new gardenCallback(callbacks_, dest, lvl_, tType, typeKey));
+    if (lvl_.terrainAt(dest).type() == tType) {
+      // forget flowers which have already spread:
+      timers_.erase(std::remove_if(timers_.begin(), timers_.end(),
+				   [](const time::timer &t) { return !time::pending(t); }),
+		    timers_.end());
+      // each tick has the same chance as dPc() < 20 (which is 210 in 51*51):
+      timers_.push_back(time::afterChance(210.0 / 2601.0, gardenCallback(dest, lvl_, tType, typeKey)));
+    }
   }
   return false;
 }
@@ -81,32 +90,22 @@ bool gardenZone::onExit(item &ite, itemHolder &next) {
 }
 
 
-gardenCallback::gardenCallback(std::vector<std::shared_ptr<gardenCallback>> &callbacks,
-			       const coord &dest, level &lvl,
+gardenCallback::gardenCallback(const coord &dest, level &lvl,
 			       const terrainType & tType,
 			       const itemTypeKey &typeKey) :
-  temporal::callback(true, std::ref(*this)),
-  callbacks_(callbacks),
   dest_(dest),
   lvl_(lvl),
   tType_(tType),
   typeKey_(typeKey) {}
 
-gardenCallback::~gardenCallback() {}
-
 void gardenCallback::operator()() {
-    if (dPc() < 20) {
-      auto minX = dest_.first - 1; if (minX < 0) minX+=1;
-      auto minY = dest_.second - 1; if (minY < 0) minY+=1;
-      auto maxX = dest_.first + 1; if (maxX >= level::MAX_WIDTH) maxX-=1;
-      auto maxY = dest_.second + 1; if (maxY >= level::MAX_HEIGHT) maxY-=1;
-      for (auto x = minX; x <= maxX; ++x)
-	for (auto y = minY; y <= maxY; ++y)
-	  if (lvl_.terrainAt(coord(x,y)).type() == tType_)
-	    lvl_.holder(coord(x,y)).
-	      addItem(createItem(typeKey_));
-      callbacks_.erase(std::remove_if(callbacks_.begin(), callbacks_.end(),
-				      [this](const std::shared_ptr<gardenCallback> &i) { return i.get() == this;}
-				      ), callbacks_.end());
-    }
-  }
+  auto minX = dest_.first - 1; if (minX < 0) minX+=1;
+  auto minY = dest_.second - 1; if (minY < 0) minY+=1;
+  auto maxX = dest_.first + 1; if (maxX >= level::MAX_WIDTH) maxX-=1;
+  auto maxY = dest_.second + 1; if (maxY >= level::MAX_HEIGHT) maxY-=1;
+  for (auto x = minX; x <= maxX; ++x)
+    for (auto y = minY; y <= maxY; ++y)
+      if (lvl_.terrainAt(coord(x,y)).type() == tType_)
+	lvl_.holder(coord(x,y)).
+	  addItem(createItem(typeKey_));
+}
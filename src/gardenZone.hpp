@@ -35,7 +35,8 @@ private:
   //const coord ul_;
   //  const coord lr_;
   level &lvl_;
-  std::vector<std::shared_ptr<gardenCallback>> callbacks_;
+  // pending growth; cancelled if the garden goes first
+  std::vector<time::timer> timers_;
 public:
   gardenZone(std::unique_ptr<geometry> &&, level &lev, bool hostile);
   virtual ~gardenZone();
@@ -54,18 +55,16 @@ public:
 };
 
 
-class gardenCallback : public temporal::callback {
+// flowers spread to matching terrain around where they were planted
+class gardenCallback {
 private:
-  std::vector<std::shared_ptr<gardenCallback>> &callbacks_;
   coord dest_;
   level &lvl_;
   const terrainType tType_;
   const itemTypeKey typeKey_;
 public:
-  gardenCallback(std::vector<std::shared_ptr<gardenCallback>> &callbacks,
-		 const coord &dest, level &lvl,
+  gardenCallback(const coord &dest, level &lvl,
 		 const terrainType & tType, const itemTypeKey &typeKey);
-  virtual ~gardenCallback();
   void operator()();
 };
 
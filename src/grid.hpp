@@ -0,0 +1,72 @@
+/* License and copyright go here*/
+
+// dense storage of one value for each square of a level
+
+#ifndef GRID_HPP__
+#define GRID_HPP__
+
+#include "coord.hpp"
+#include <array>
+
+/*
+ * Fixed-size, row-major array of W*H values, one per coordinate.
+ * Much cheaper than a std::map<coord, T> for anything that covers the
+ * whole map, as lookups are a multiply and an add, and the storage is
+ * contiguous.
+ *
+ * NB: No bounds checking is done by operator[]; use contains() first
+ * if the coordinate may be off the map.
+ */
+template <typename T, int W, int H>
+class grid {
+public:
+  static constexpr int width = W;
+  static constexpr int height = H;
+  static constexpr int size = W * H;
+private:
+  std::array<T, size> cells_;
+public:
+  grid() : cells_() {}
+  explicit grid(const T &fill) { cells_.fill(fill); }
+
+  // is this coordinate on the map?
+  static bool contains(const coord &c) {
+    return c.first >= 0 && c.second >= 0 && c.first < W && c.second < H;
+  }
+  // offset of a coordinate into the array
+  static int index(const coord &c) {
+    return c.second * W + c.first;
+  }
+  // coordinate of an offset into the array
+  static coord coordOf(const int idx) {
+    return coord(idx % W, idx / W);
+  }
+
+  T &operator[](const coord &c) { return cells_[index(c)]; }
+  const T &operator[](const coord &c) const { return cells_[index(c)]; }
+  T &operator[](const int idx) { return cells_[idx]; }
+  const T &operator[](const int idx) const { return cells_[idx]; }
+
+  void fill(const T &t) { cells_.fill(t); }
+
+  /*
+   * Call f(cell, coord) for each on-map square of the 3x3 block centred
+   * on c (including c), x-major: (-1,-1), (-1,0), (-1,+1), (0,-1)...
+   */
+  template <typename F>
+  void forEachAdjacent(const coord &c, F f) const {
+    for (int dx = -1; dx <= 1; ++dx)
+      for (int dy = -1; dy <= 1; ++dy) {
+	const coord n(c.first + dx, c.second + dy);
+	if (contains(n)) f(cells_[index(n)], n);
+      }
+  }
+
+  // iterate in row-major order (the same order as coordRectIterator)
+  typename std::array<T, size>::iterator begin() { return cells_.begin(); }
+  typename std::array<T, size>::iterator end() { return cells_.end(); }
+  typename std::array<T, size>::const_iterator begin() const { return cells_.begin(); }
+  typename std::array<T, size>::const_iterator end() const { return cells_.end(); }
+};
+
+#endif //ndef GRID_HPP__
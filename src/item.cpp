@@ -187,18 +187,25 @@ bool basicItem::isProof(const damageType &type) const {
   return false;
 }
 
+void basicItem::reweigh() {
+  auto h = itemHolderMap::instance().holderOf(*this);
+  if (h) h->weightChanged();
+}
+
 // access flags:
 bool basicItem::isBlessed() const {
   return flags_[blessed];
 }
 void basicItem::bless(bool b) {
   flags_[blessed] = b;
+  reweigh();
 }
 bool basicItem::isCursed() const {
   return flags_[cursed];
 }
 void basicItem::curse(bool c) {
   flags_[cursed] = c;
+  reweigh();
 }
 bool basicItem::isSexy() const {
   return flags_[sexy];
@@ -228,6 +235,7 @@ void basicItem::enchant(int enchantment) {
     slots = owner->forceUnequip(*this);
   }
   enchantment_ += enchantment;
+  reweigh();
   if (owner && slots[0]) {
     // signal to recalculate the bonus if this item is equipped
     owner->equip(*this, slots);
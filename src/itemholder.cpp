@@ -12,6 +12,7 @@
 #include <set>
 #include <bitset>
 #include <algorithm>
+#include <unordered_map>
 
 
 itemHolderMap& itemHolderMap::instance() {
@@ -22,8 +23,10 @@ itemHolderMap& itemHolderMap::instance() {
 class itemHolderMapImpl {
 private:
   std::map<std::shared_ptr<item>, itemHolder*> map_;
+  // the same, by raw pointer, so we can look up items still being constructed
+  std::unordered_map<const item *, itemHolder*> holders_;
 public:
-  itemHolderMapImpl() : map_() {}
+  itemHolderMapImpl() : map_(), holders_() {}
   void enroll(item &i) {
     // we can't call shared_from_this on an item until it has at least one
     // shared_ptr; as shared_ptr simply stores a weak_ptr on the item if it
@@ -33,6 +36,7 @@ public:
     // this breaks RAII, but is a design issue with shared_ptr.
     auto pi = std::shared_ptr<item>(&i);
     map_[pi] = nullptr;
+    holders_[&i] = nullptr;
   }
   itemHolder &forItem(item &i) {
     auto pi = from(i);
@@ -47,11 +51,17 @@ public:
   void move(item &i, itemHolder &h) {
     auto pi = from(i);
     map_[pi] = &h;
+    holders_[&i] = &h;
   }
   void destroy(item &i) {
     auto pi = from(i);
+    holders_.erase(&i);
     map_.erase(pi);
   }
+  itemHolder *holderOf(const item &i) const {
+    auto find = holders_.find(&i);
+    return find == holders_.end() ? nullptr : find->second;
+  }
   bool contains(const item &i, const itemHolder &h) const {
     auto pi = from(i);
     auto find = map_.find(pi);
@@ -91,6 +101,7 @@ void itemHolderMap::destroy(item & i) { pImpl_->destroy(i); }
 bool itemHolderMap::contains(const item & i, const itemHolder &h) const { return pImpl_->contains(i,h); }
 void itemHolderMap::enroll(item & i) { pImpl_->enroll(i); }
 bool itemHolderMap::beforeFirstAdd(const item & i) const { return pImpl_->beforeFirstAdd(i); }
+itemHolder *itemHolderMap::holderOf(const item & i) const { return pImpl_->holderOf(i); }
 
 optionalRef<item> itemHolderMap::rndIf(std::function<bool(item &)> pred) {
   return pImpl_->rndIf(pred);
@@ -99,12 +110,14 @@ optionalRef<item> itemHolderMap::rndIf(std::function<bool(item &)> pred) {
 bool itemHolder::addItem(item &item) {
   auto &map = itemHolderMap::instance();
   auto pi = item.shared_from_this(); // keep alive
-  if (!map.beforeFirstAdd(item)) {
-    auto &h = map.forItem(item);
-    if (!h.removeItemForMove(item, *this)) return false;
+  auto h = map.holderOf(item);
+  if (h) {
+    if (!h->removeItemForMove(item, *this)) return false;
+    h->weightChanged(); // in case removeItemForMove() is overridden
   }
   map.move(item, *this);
   contents_.push_back(pi);
+  weightChanged();
   pi->onAdd(*this);
   return true;
 }
@@ -114,6 +127,7 @@ bool itemHolder::removeItemForMove(item &it, itemHolder &holder) {
   for (auto iter = contents_.begin(); iter != contents_.end(); ++iter)
     if (iter->lock().get() == &it) {
       contents_.erase(iter);
+      weightChanged();
       break;
     }
   return true;
@@ -126,6 +140,7 @@ bool itemHolder::destroyItem(item &item) {
   for (auto iter = contents_.begin(); iter != contents_.end(); ++iter)
     if (iter->lock().get() == &item) {
       contents_.erase(iter);
+      weightChanged();
       break;
     }
   return rtn;
@@ -175,6 +190,7 @@ bool itemHolder::replaceItem(item &from, item &to) {
     if (i->lock().get() == &from) {
       i = contents_.erase(i);
       contents_.insert(i, to.shared_from_this());
+      weightChanged();
       to.onAdd(*this);
       return true;
     }
@@ -182,13 +198,25 @@ bool itemHolder::replaceItem(item &from, item &to) {
 }
 
 double itemHolder::totalWeight() const  {
+  if (weightValid_) return weight_;
   double totalWeight=0;
   forEachItem([&totalWeight](const item &i, std::wstring) {
       totalWeight += i.weight();
     });
+  weight_ = totalWeight;
+  weightValid_ = true;
   return totalWeight;
 }
 
+void itemHolder::weightChanged() {
+  weightValid_ = false;
+  // if we're a container, we've changed the weight of whatever holds us:
+  auto pItem = asItem();
+  if (!pItem) return;
+  auto h = itemHolderMap::instance().holderOf(*pItem);
+  if (h) h->weightChanged();
+}
+
 item *itemHolder::pickItem(const std::wstring & prompt,
 			   const std::wstring & help,
 			   const std::wstring & extraHelp,
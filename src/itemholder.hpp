@@ -29,6 +29,7 @@ public:
   itemHolder &forItem(const item &); // does linear search to avoid const issues
   void enroll(item &); // called from item constructor
   bool beforeFirstAdd(const item &) const; // has this enrolled item been added via itemHolder.addItem() yet?
+  itemHolder *holderOf(const item &) const; // where is this enrolled item? nullptr if not added yet. Unlike forItem(), no linear search.
   optionalRef<item> rndIf(std::function<bool(item &)>); // pick a random item matching functor from the entire game.
 protected:
   void destroy(item &);
@@ -46,7 +47,11 @@ protected:
 class itemHolder {
 private:
   std::vector<std::weak_ptr<item> > contents_;
+  // cached totalWeight(), if weightValid_
+  mutable double weight_;
+  mutable bool weightValid_;
 public:
+  itemHolder() : contents_(), weight_(0), weightValid_(false) {}
   virtual ~itemHolder() = default;
   // add an item to this container (removing it from any previous container).
   // add may fail if previous container's removeItemForMove() returns false.
@@ -76,7 +81,15 @@ public:
   // if adding "to" to the container fails, "from" must be replaced.
   bool replaceItem(item &from, item &to);
   // convenience method to get the total weight in container.
+  // This is cached, so is cheap to call each turn.
   double totalWeight() const;
+  // Forget the cached totalWeight(), of this and any containers it's in.
+  // Called whenever the contents change; call it also when something
+  // inside changes weight (eg on blessing or cursing a container).
+  void weightChanged();
+  // if this holder is also an item (ie a container), that item; else nullptr.
+  // Containers must override this, so weightChanged() can reach whatever holds them.
+  virtual const item *asItem() const { return nullptr; }
   // prompt the player for an item via io::instance():
   item* pickItem(const std::wstring & prompt,
 		 const std::wstring & help,
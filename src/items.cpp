@@ -16,6 +16,7 @@
 #include "transport.hpp"
 #include "target.hpp"
 #include "combat.hpp"
+#include "aliasTable.hpp"
 
 extern std::vector<damageType> allDamageTypes;
 
@@ -690,6 +691,7 @@ public:
     basicItem(type) {}
   bottle(const bottle &) = delete;
   virtual ~bottle() {}
+  virtual const item *asItem() const { return this; }
   bool isShipInBottle() const {
     optionalRef<const item> c = content();
     auto cName = c.value().name();
@@ -856,11 +858,9 @@ public:
     basicItem(type),
     useWithMixin() {}
   virtual ~basicContainer() {}
+  virtual const item *asItem() const { return this; }
   virtual double weight() const {
-    double rtn = basicItem::weight();
-    forEachItem([&rtn](const item &item, std::wstring) {
-	rtn += item.weight();
-      });
+    double rtn = basicItem::weight() + totalWeight();
     if (isBlessed()) rtn *= 0.9;
     if (isCursed()) rtn *= 2;
     return rtn;
@@ -1202,6 +1202,7 @@ public:
 	     // story reason: In Knightmare, you see napsacks worn under cloaks, but over shirts.
 	     std::make_pair(slotType::hauburk, slotType::doublet)) {}
   virtual ~napsackOfConsumption() {};
+  virtual const item *asItem() const { return this; }
   virtual item::useResult use() {
     if (!usable()) return item::useResult::FAIL;
     const std::wstring name(basicItem::name());
@@ -2850,34 +2851,81 @@ item &createRndEquippable(const itemTypeKey &type) {
 }
 
 
+/*
+ * What createRndItem() can make at one depth, and how likely each is.
+ * Any generatable type is equally likely; the rules for what can't be
+ * generated (and what must be bottled or enchanted) are applied once,
+ * when the table is built, rather than by rejecting types on each call.
+ */
+class rndItemTable {
+public:
+  enum class kind { PLAIN, MAGIC, BOTTLED };
+private:
+  std::vector<std::pair<itemTypeKey, kind>> outcomes_;
+  aliasTable table_;
+  void add(itemTypeKey type, kind k, uint64_t weight, std::vector<uint64_t> &weights) {
+    if (weight == 0) return;
+    outcomes_.emplace_back(type, k);
+    weights.push_back(weight);
+  }
+public:
+  rndItemTable(const int depth, const bool allowLiquids) :
+    outcomes_(), table_() {
+    // each type gets one chance in 51*51 for each possible dPc() roll:
+    const uint64_t rolls = 51*51;
+    const unsigned char *pc = dPcTable();
+    const uint64_t magic = std::lower_bound(pc, pc + rolls, depth) - pc; // rolls under depth
+    std::vector<uint64_t> weights;
+    for (auto &type : itemTypeRepo::instance()) {
+      // we can produce water, but we must bottle it:
+      if (type.first == itemTypeKey::water && !allowLiquids) {
+	add(type.first, kind::BOTTLED, rolls, weights);
+	continue;
+      }
+      // other more exotic liquids are usually ignored:
+      if (!allowLiquids && type.second->material() == materialType::liquid) continue;
+      // we never autogenerate a corpse because they always need a monster first:
+      if (type.first == itemTypeKey::corpse) continue;
+      // we never autogenerate an IOU; they're only created by shops
+      if (type.first == itemTypeKey::iou) continue;
+      // don't autogenerate napsacks of consumption; they're for Dungeoneers:
+      if (type.first == itemTypeKey::napsack_of_consumption) continue;
+      // don't autogenerate water transport:
+      if (type.first == itemTypeKey::bridge) continue;
+      if (type.first == itemTypeKey::ship) continue;
+      // don't randomly create water plants:
+      if (type.first == itemTypeKey::lily) continue;
+      if (type.first == itemTypeKey::lotus) continue;
+      // some jewellery is magic:
+      const uint64_t plain = type.second->render() == L'*' ? rolls - magic : rolls;
+      if (plain != rolls) add(type.first, kind::MAGIC, magic, weights);
+      // expensive items are found deeper down:
+      if (depth < 90 && appraiseFairly(*type.second) > 100 * (depth+1)) continue;
+      add(type.first, kind::PLAIN, plain, weights);
+    }
+    if (weights.empty()) throw std::wstring(L"No items can be generated at depth ") + std::to_wstring(depth);
+    table_ = aliasTable(weights);
+  }
+  template <typename G>
+  const std::pair<itemTypeKey, kind> &operator()(G &gen) const {
+    return outcomes_[table_(gen)];
+  }
+};
+
 // create a random item suitable for the given level depth
 item &createRndItem(const int depth, bool allowLiquids) {
-  auto &r = itemTypeRepo::instance();
-  while (true) {
-    auto type = rndPick(r.begin(), r.end());
-    // we can produce water, but we must bottle it:
-    if (type->first == itemTypeKey::water && !allowLiquids)
-      return createBottledItem<itemTypeKey::water>();
-    // other more exotic liquids are usually ignored:
-    if (!allowLiquids && r[type->first].material() == materialType::liquid) continue;
-    // we never autogenerate a corpse because they always need a monster first:
-    if (type->first == itemTypeKey::corpse) continue;
-    // we never autogenerate an IOU; they're only created by shops
-    if (type->first == itemTypeKey::iou) continue;
-    // don't autogenerate napsacks of consumption; they're for Dungeoneers:
-    if (type->first == itemTypeKey::napsack_of_consumption) continue;
-    // don't autogenerate water transport:
-    if (type->first == itemTypeKey::bridge) continue;
-    if (type->first == itemTypeKey::ship) continue;
-    // don't randomly create water plants:
-    if (type->first == itemTypeKey::lily) continue;
-    if (type->first == itemTypeKey::lotus) continue;
-    // some jewellery is magic:
-    if (type->second->render() == L'*' && dPc() < depth)
-      return createRndEquippable(type->first);
-    if (depth < 90 && appraiseFairly(*type->second) > 100 * (depth+1)) continue;
-    // general case: call createItem():
-    return createItem(type->first); // already enrolled
+  rngScope loot(rngStream::LOOT);
+  // every depth from 101 down rolls the same, as dPc() <= 100 (and likewise below 0):
+  const int d = depth < 0 ? 0 : depth > 101 ? 101 : depth;
+  static std::vector<std::unique_ptr<rndItemTable>> tables[2];
+  auto &byDepth = tables[allowLiquids ? 1 : 0];
+  if (byDepth.size() <= static_cast<size_t>(d)) byDepth.resize(d + 1);
+  if (!byDepth[d]) byDepth[d].reset(new rndItemTable(d, allowLiquids));
+  auto &pick = (*byDepth[d])(generator);
+  switch (pick.second) {
+  case rndItemTable::kind::BOTTLED: return createBottledItem<itemTypeKey::water>();
+  case rndItemTable::kind::MAGIC: return createRndEquippable(pick.first);
+  default: return createItem(pick.first); // already enrolled
   }
 }
 
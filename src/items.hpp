@@ -162,6 +162,8 @@ level &curLevel(itemHolder &);
 class basicItem : public item {
 private:
   enum { blessed, cursed, unidentified, sexy, NUM_FLAGS } flags;
+  // blessing, cursing & enchanting change the weight of some items; tell whatever holds us
+  void reweigh();
   std::map<damageType, int> damageTrack_;
   // what are we *explicitly* proof against?
   // something may be proof against a material even with no damage track; this may
@@ -16,12 +16,28 @@
 #include "transport.hpp"
 #include "ref.hpp"
 #include "combat.hpp"
+#include "grid.hpp"
+#include "distanceMap.hpp"
+#include "sightLines.hpp"
+#include "fov.hpp"
+#include "cache.hpp"
+#include "time.hpp"
+#include "mobile.hpp"
+#include "threadPool.hpp"
 
 #include <algorithm> // max/min
+#include <atomic>
 #include <random>
 #include <vector>
 #include <string>
 #include <sstream>
+#include <unordered_map>
+#include <bitset>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 // define a level in the dungeon
 
@@ -268,26 +284,105 @@ std::wstring nth(const int i) {
   return rtn.str();
 }
 
-class terrainRef : public ref<const terrain> {
-public:
-  terrainRef() :
-    ref<const terrain>(tFactory.get(terrainType::GROUND)) {}
-  terrainRef(const terrain &other) :
-    ref<const terrain>(other) {}
-  terrainType type() const { return value().type(); }
-};
-
 // implementation of level class 
 class levelImpl : public renderByCoord {
 public:
-  // the dungeon this level is in
-  dungeon& dungeon_;
+  // the dungeon this level is in; nullptr for levels built by layoutLevel() (no monsters or items)
+  dungeon * const dungeon_;
   // how many levels deep are we?
   const int depth_;
-  // map of coordinate to all monsters at that location
-  ::std::multimap<coord, ::std::shared_ptr<monster> > monsters_;
-  // terrain type by coordinate
-  ::std::map<coord, terrainRef> terrain_;
+  // a monster on the level, and the squares it occupies (more than one for bigMonsters)
+  struct occupant {
+    ::std::shared_ptr<monster> mon_;
+    ::std::vector<coord> pos_;
+    // cached movement signature id, and the monster's moveGeneration() when it was worked out
+    bool sigValid_;
+    unsigned long sigGen_;
+    size_t sigId_;
+    // serial of this monster's live entry in actions_, or 0 if it has none
+    unsigned long action_;
+    explicit occupant(const ::std::shared_ptr<monster> &m) :
+      mon_(m), pos_(), sigValid_(false), sigGen_(0), sigId_(0), action_(0) {}
+  };
+  // when a monster is next due to act, in phases (see actionDelay())
+  struct action {
+    unsigned long long due_;
+    unsigned long serial_;
+    monster *mon_;
+    // for a heap with the soonest at the top:
+    bool operator <(const action &rhs) const { return due_ > rhs.due_; }
+  };
+  // every monster on the level
+  ::std::vector<occupant> roster_;
+  /*
+   * The state per-tick scans need from each monster, as parallel arrays
+   * at the same offsets as roster_. Scanning these avoids visiting each
+   * monster object (and its shared_ptr) in turn. Positions aren't kept
+   * here, as scans for neighbours go through occupants_ instead.
+   * Kept by refreshHot(), called via level::monsterChanged() whenever a
+   * monster's alignment or sleep changes.
+   */
+  enum hotFlag : unsigned char { hotAsleep = 1 };
+  ::std::vector<const deity *> hotAlign_;
+  ::std::vector<unsigned char> hotFlags_;
+  // how many monsters on the level have each alignment; kept with hotAlign_
+  ::std::unordered_map<const deity *, size_t> alignCount_;
+  // reverse index: monster to its offset in roster_
+  ::std::unordered_map<const monster *, size_t> rosterIdx_;
+#ifdef COUNT_MONSTER_SCANS
+  // see level::monsterScans(), level::monsterVisits() and level::rosterMisses()
+  static std::atomic<unsigned long> monsterScans_, monsterVisits_, rosterMisses_;
+  static void countScan() { ++monsterScans_; }
+  static void countVisit() { ++monsterVisits_; }
+  static void countMiss() { ++rosterMisses_; }
+#else
+  static void countScan() {}
+  static void countVisit() {}
+  static void countMiss() {}
+#endif //def COUNT_MONSTER_SCANS
+  // all monsters at each location
+  level::occupancyGrid occupants_;
+  // the player, if on this level
+  monster *pc_;
+  // time::moveCount() when this level was last ticked
+  unsigned long long lastTick_;
+  // heap of monsters waiting to act; entries go stale when their monster leaves
+  std::vector<action> actions_;
+  // last serial given to an action
+  unsigned long actionSerial_;
+  // terrain type by coordinate (row-major; see grid.hpp)
+  grid<terrainType, level::MAX_WIDTH, level::MAX_HEIGHT> terrain_;
+  // all positions of each terrain type, in no particular order
+  std::array<std::vector<coord>, terrainTypeSize> byType_;
+  // offset of each position into byType_[terrain_[pos]]
+  grid<unsigned short, level::MAX_WIDTH, level::MAX_HEIGHT> byTypeIdx_;
+  // bumped on every change of terrain, so cached data can tell it is stale
+  unsigned long terrainGeneration_;
+  // which terrain types a monster will willingly step onto; monsters with the same signature route the same way
+  typedef std::bitset<terrainTypeSize> moveSig;
+  // distinct movement signatures seen on this level; the offset is the signature id
+  std::vector<moveSig> sigs_;
+  std::unordered_map<moveSig, size_t> sigIds_;
+  // squares each signature id can move onto, keyed by terrain generation
+  // (a deque, so passable() references survive new signatures turning up while monsters plan)
+  std::deque<generationCache<level::passLayer> > layers_;
+  typedef distanceMap<level::MAX_WIDTH, level::MAX_HEIGHT> flow;
+  // distance to the player for each signature id, keyed by terrain generation & player position
+  std::deque<generationCache<flow, std::pair<unsigned long, coord> > > pcFlows_;
+  // distance to the nearest of a terrain type, indexed by goal terrain type, then signature id
+  std::array<std::deque<generationCache<flow> >, terrainTypeSize> goalFlows_;
+  // recent fields of view, keyed by terrain generation, viewer & radius;
+  // a few slots, chosen by viewer position, so viewers on different squares rarely collide
+  typedef std::pair<unsigned long, std::pair<coord, int> > viewKey;
+  mutable std::array<generationCache<level::viewLayer, viewKey>, 16> views_;
+  /*
+   * Guards the signature & routing caches above while monsters plan on
+   * several threads. It is held only to look up (and if need be build) a
+   * layer or map: nothing a map depends on changes while monsters plan,
+   * so once built it can be read without the lock. prepareRoutes()
+   * builds them before planning starts, so the lookups rarely wait.
+   */
+  std::mutex routeLock_;
   // what special zones are in this level?
   std::vector<std::shared_ptr<zoneArea<item> > > itemZones_;
   std::vector<std::shared_ptr<zoneArea<monster> > > monsterZones_;
@@ -299,13 +394,38 @@ public:
   std::wstring name_;
 
   // constructor fills the level with something suitable
-  levelImpl(dungeon &dungeon, int depth) :
+  levelImpl(dungeon *dungeon, int depth) :
     dungeon_(dungeon),
     depth_(depth),
+    roster_(),
+    hotAlign_(),
+    hotFlags_(),
+    alignCount_(),
+    rosterIdx_(),
+    occupants_(),
+    pc_(nullptr),
+    lastTick_(0),
+    actions_(),
+    actionSerial_(0),
+    terrain_(terrainType::ROCK),
+    byType_(),
+    byTypeIdx_(),
+    terrainGeneration_(0),
+    sigs_(),
+    sigIds_(),
+    layers_(),
+    pcFlows_(),
+    goalFlows_(),
+    views_(),
+    routeLock_(),
     name_(L"The " + nth(depth) + L" Area of Adventure") {
-    using namespace std;
-    for (coord c : coordRectIterator(0, 0, level::MAX_WIDTH-1, level::MAX_HEIGHT-1))
-      terrain_[c] = tFactory.get(terrainType::ROCK);
+    // levels start as solid rock:
+    auto &rock = byType_[static_cast<size_t>(terrainType::ROCK)];
+    rock.reserve(terrain_.size);
+    for (int i=0; i < terrain_.size; ++i) {
+      rock.emplace_back(terrain_.coordOf(i));
+      byTypeIdx_[i] = i;
+    }
   }
   virtual ~levelImpl() {}
 
@@ -321,47 +441,318 @@ public:
     return drawIter(*this, coord(-1,-1), level::MAX_WIDTH, level::MAX_HEIGHT);
   }
 
+  // the occupancy entry for a monster, or nullptr if it isn't on this level.
+  // NB: Invalidated by adding or removing monsters.
+  occupant *occupantOf(const monster &m) {
+    auto i = rosterIdx_.find(&m);
+    if (i != rosterIdx_.end()) return &roster_[i->second];
+    countMiss();
+    return nullptr;
+  }
+  const occupant *occupantOf(const monster &m) const {
+    return const_cast<levelImpl *>(this)->occupantOf(m);
+  }
+
+  // the monsters at the given square (which need not be on the map)
+  const std::vector<monster *> &occupantsAt(const coord &c) const {
+    static const std::vector<monster *> none;
+    return occupants_.contains(c) ? occupants_[c] : none;
+  }
+
+  // record that m occupies c (as well as anywhere else it already is)
+  void occupy(const std::shared_ptr<monster> &m, const coord &c) {
+    auto i = rosterIdx_.find(m.get());
+    if (i == rosterIdx_.end()) {
+      i = rosterIdx_.emplace(m.get(), roster_.size()).first;
+      roster_.push_back(occupant(m));
+      hotAlign_.push_back(nullptr);
+      hotFlags_.push_back(0);
+      refreshHot(i->second);
+      if (m->isPlayer()) pc_ = m.get();
+      // monsters which act may do so from the next tick:
+      if (m->acts()) schedule(roster_.back(), (time::moveCount() + 1) * phasesPerTick);
+    }
+    auto &pos = roster_[i->second].pos_;
+    if (std::find(pos.begin(), pos.end(), c) != pos.end()) return; // already here
+    pos.push_back(c);
+    if (occupants_.contains(c)) occupants_[c].push_back(m.get());
+  }
+
+  // copy the monster's current alignment & sleep into the hot arrays
+  void refreshHot(const size_t idx) {
+    const monster &m = *roster_[idx].mon_;
+    const deity *align = &m.align();
+    if (hotAlign_[idx] != align) {
+      if (hotAlign_[idx]) forgetAlign(*hotAlign_[idx]);
+      ++alignCount_[align];
+      hotAlign_[idx] = align;
+    }
+    hotFlags_[idx] = m.sleeping() ? hotAsleep : 0;
+  }
+
+  // one fewer monster has the given alignment
+  void forgetAlign(const deity &align) {
+    auto i = alignCount_.find(&align);
+    if (--(i->second) == 0) alignCount_.erase(i);
+  }
+
+  void monsterChanged(const monster &m) {
+    auto i = rosterIdx_.find(&m);
+    if (i != rosterIdx_.end()) refreshHot(i->second);
+    else countMiss();
+  }
+
+  // asks each alignment present, rather than each monster
+  bool anyCoaligned(const deity &d) const {
+    for (auto &a : alignCount_)
+      if (a.first->coalignment(d) >= 3) return true;
+    return false;
+  }
+
+  // record that m no longer occupies c
+  void vacate(monster &m, const coord &c) {
+    if (!occupants_.contains(c)) return;
+    auto &cell = occupants_[c];
+    cell.erase(std::remove(cell.begin(), cell.end(), &m), cell.end());
+  }
+
+  // queue o's monster to act at the given phase
+  void schedule(occupant &o, unsigned long long due) {
+    o.action_ = ++actionSerial_;
+    actions_.push_back(action{due, o.action_, o.mon_.get()});
+    std::push_heap(actions_.begin(), actions_.end());
+  }
+
+  // remove m from all squares, but leave it on the level
+  void vacateAll(occupant &o) {
+    for (auto &c : o.pos_) vacate(*o.mon_, c);
+    o.pos_.clear();
+  }
+
+  // remove m from the level entirely
+  void unoccupy(const monster &m) {
+    auto i = rosterIdx_.find(&m);
+    if (i == rosterIdx_.end()) {
+      countMiss();
+      return;
+    }
+    const size_t idx = i->second;
+    if (pc_ == &m) pc_ = nullptr;
+    forgetAlign(*hotAlign_[idx]);
+    vacateAll(roster_[idx]);
+    rosterIdx_.erase(i);
+    // swap-and-pop to keep removal constant-time:
+    if (idx != roster_.size() - 1) {
+      roster_[idx] = std::move(roster_.back());
+      rosterIdx_[roster_[idx].mon_.get()] = idx;
+      hotAlign_[idx] = hotAlign_.back();
+      hotFlags_[idx] = hotFlags_.back();
+    }
+    roster_.pop_back();
+    hotAlign_.pop_back();
+    hotFlags_.pop_back();
+  }
+
   virtual const renderable & renderableAt(const coord & pos) const {
     // show monsters if any:
-    auto mn = monsters_.equal_range(pos);
-    if (mn.first != mn.second) return *(mn.first->second);
+    auto &mn = occupantsAt(pos);
+    if (!mn.empty()) return *(mn.front());
     // show items if any:
     auto it = holder(pos).firstItem();
     if (it) return it.value();
     // show terrain if nothing else:
-    return terrain_.at(pos).value();
+    return terrainAt(pos);
+  }
+
+  // the type of terrain at c. Anything off the map is solid rock.
+  terrainType typeAt(const coord &c) const {
+    return terrain_.contains(c) ? terrain_[c] : terrainType::ROCK;
+  }
+
+  // all terrain changes come through here. Squares off the map are ignored.
+  void setTerrain(const coord &c, terrainType t) {
+    if (!terrain_.contains(c)) return;
+    const terrainType old = terrain_[c];
+    if (old == t) return;
+    // swap-and-pop from the old type's list:
+    auto &from = byType_[static_cast<size_t>(old)];
+    const auto idx = byTypeIdx_[c];
+    from[idx] = from.back();
+    byTypeIdx_[from[idx]] = idx;
+    from.pop_back();
+    // and append to the new:
+    auto &to = byType_[static_cast<size_t>(t)];
+    byTypeIdx_[c] = to.size();
+    to.push_back(c);
+    terrain_[c] = t;
+    ++terrainGeneration_;
+    // forget routes to the old or new terrain, or through here if it changes who can pass:
+    for (size_t g=0; g < terrainTypeSize; ++g)
+      for (size_t id=0; id < goalFlows_[g].size(); ++id)
+	if (g == static_cast<size_t>(old) || g == static_cast<size_t>(t) ||
+	    sigs_[id][static_cast<size_t>(old)] != sigs_[id][static_cast<size_t>(t)])
+	  goalFlows_[g][id].invalidate();
   }
 
   const terrain &terrainAt(const coord & c) const {
-    return terrain_.at(c).value();
+    return tFactory.get(typeAt(c));
+  }
+
+  // the terrain types m will move onto, avoiding visible traps (as movable() does, but ignoring vehicles)
+  moveSig movementSignature(const monster &m) const {
+    moveSig rtn;
+    for (size_t i=0; i < terrainTypeSize; ++i) {
+      auto &t = tFactory.get(static_cast<terrainType>(i));
+      rtn[i] = m.abilities()->move(t) && !t.entraps(m, false);
+    }
+    return rtn;
+  }
+
+  // small id for m's movement signature; cached while m is on this level and its abilities don't change
+  size_t sigId(const monster &m) {
+    auto o = occupantOf(m);
+    const unsigned long gen = m.abilities()->moveGeneration();
+    if (o && o->sigValid_ && o->sigGen_ == gen) return o->sigId_;
+    const moveSig sig = movementSignature(m);
+    auto i = sigIds_.find(sig);
+    size_t id;
+    if (i != sigIds_.end()) id = i->second;
+    else {
+      id = sigs_.size();
+      sigIds_.emplace(sig, id);
+      sigs_.push_back(sig);
+      layers_.emplace_back();
+      pcFlows_.emplace_back();
+      for (auto &g : goalFlows_) g.emplace_back();
+    }
+    if (o) o->sigValid_ = true, o->sigGen_ = gen, o->sigId_ = id;
+    return id;
+  }
+
+  const level::passLayer &passable(const size_t id) {
+    static cacheStats stats(L"Passability layers");
+    return layers_.at(id).get(terrainGeneration_, stats, [this, id](level::passLayer &l) {
+	auto &sig = sigs_[id];
+	for (int i=0; i < terrain_.size; ++i)
+	  l[i] = sig[static_cast<size_t>(terrain_[i])];
+      });
+  }
+
+  // as passable(id), for the public interface; see routeLock_
+  const level::passLayer &passable(const monster &m) {
+    std::lock_guard<std::mutex> lock(routeLock_);
+    return passable(sigId(m));
+  }
+
+  // distances to the player for monsters moving as m does, or nullptr if the player isn't here; see routeLock_
+  const flow *pcFlow(const monster &m) {
+    std::lock_guard<std::mutex> lock(routeLock_);
+    const coord pc = pcPos();
+    if (pc.first < 0) return nullptr;
+    static cacheStats stats(L"Player distance maps");
+    const size_t id = sigId(m);
+    // recalculate if the player or terrain has changed since we last looked:
+    return &pcFlows_.at(id).get(std::make_pair(terrainGeneration_, pc), stats, [this, id, &pc](flow &f) {
+	auto &pass = passable(id);
+	const coord src[] = { pc };
+	f.build(std::begin(src), std::end(src), [&pass](const coord &c) {
+	    return pass[c.first + c.second * level::MAX_WIDTH];
+	  });
+      });
+  }
+
+  // distances to the nearest square of the goal terrain, for monsters moving as m does; see routeLock_
+  const flow &goalFlow(const monster &m, const terrainType goal) {
+    std::lock_guard<std::mutex> lock(routeLock_);
+    static cacheStats stats(L"Terrain distance maps");
+    const size_t id = sigId(m);
+    // invalidated by setTerrain() only where the change is relevant:
+    return goalFlows_[static_cast<size_t>(goal)].at(id).get(stats, [this, id, goal](flow &f) {
+	auto &pass = passable(id);
+	auto &goals = findAllTerrain(goal);
+	f.build(goals.begin(), goals.end(), [&pass](const coord &c) {
+	    return pass[c.first + c.second * level::MAX_WIDTH];
+	  });
+      });
+  }
+
+  dir towardsPlayer(const monster &m, const coord &from, const dir &prefer) {
+    const flow *f = pcFlow(m);
+    return f ? f->downhill(from, prefer) : dir(0,0);
+  }
+
+  dir towardsTerrain(const monster &m, const coord &from, const terrainType goal, const dir &prefer) {
+    return goalFlow(m, goal).downhill(from, prefer);
+  }
+
+  coord nearestTerrain(const monster &m, coord from, const terrainType goal) {
+    auto &f = goalFlow(m, goal);
+    if (f[from] == flow::unreachable) return coord(-1,-1);
+    // each step downhill is one closer, so this ends on a goal square:
+    while (f[from] > 0) {
+      const dir d = f.downhill(from);
+      from = coord(from.first + d.first, from.second + d.second);
+    }
+    return from;
+  }
+
+  /*
+   * Build the layers & maps the given monsters will want while they plan,
+   * one after another, so planning threads find them ready.
+   * (These are the ones planMove() asks for.)
+   */
+  void prepareRoutes(const std::vector<std::shared_ptr<monster> > &mons) {
+    for (auto &pM : mons) {
+      const movementType &type = pM->movement();
+      const terrainType goal = seeks(type.goTo_);
+      if (goal != terrainType::END) goalFlow(*pM, goal);
+      else if (type.goBy_ == goBy::smart) {
+	passable(*pM);
+	if (type.goTo_ != goTo::wander) pcFlow(*pM);
+      }
+    }
+  }
+
+  unsigned long terrainGeneration() const {
+    return terrainGeneration_;
+  }
+
+  const level::viewLayer &fieldOfView(const coord &viewer, const int radius) const {
+    static cacheStats stats(L"Fields of view");
+    auto &slot = views_[terrain_.contains(viewer) ? terrain_.index(viewer) % views_.size() : 0];
+    return slot.get(std::make_pair(terrainGeneration_, std::make_pair(viewer, radius)), stats,
+		    [this, &viewer, radius](level::viewLayer &l) {
+	fov<level::MAX_WIDTH, level::MAX_HEIGHT>::cast(viewer, radius, [this](const coord &c) {
+	    return tFactory.get(terrain_[c]).opaque();
+	  }, l);
+      });
+  }
+
+  bool canSee(const coord &viewer, const coord &target, const int radius) const {
+    return terrain_.contains(target) && fieldOfView(viewer, radius)[terrain_.index(target)];
   }
 
   bool isTerrainAdjacent(const terrainType &t, const coord &c) const {
     coordRectIterator cri(c.first-1,c.second-1,c.first+1,c.second+1);
-    auto nf = terrain_.end(); // not-found reference, in case we're at the edge
     for (auto cor : cri) { // NB: This will not loop, even in a space zone. This is not currently a problem.
-      if (cor == c) continue;
-      auto pt = terrain_.find(cor);
-      if (pt != nf && pt->second.value().type() == t) return true;
+      if (cor == c || !terrain_.contains(cor)) continue; // in case we're at the edge
+      if (terrain_[cor] == t) return true;
     }
     return false;
   }
 
+  // the first in row-major order; the order of byType_ depends on the history of edits
   coord findTerrain(const terrainType &type) const {
     using namespace std;
-    for (coord c : coordRectIterator(0,0,level::MAX_WIDTH-1, level::MAX_HEIGHT - 1))
-      if (terrain_.at(c).type() == type) 
-	return c;
+    auto &all = findAllTerrain(type);
+    if (!all.empty()) return *min_element(all.begin(), all.end(), [this](const coord &a, const coord &b) {
+	  return terrain_.index(a) < terrain_.index(b);
+	});
     throw wstring(L"Terrain type ") + to_string(type) + wstring(L" not found on level ") + to_wstring(depth_);
   }
 
-  std::vector<coord> findAllTerrain(const terrainType &type) const {
-    using namespace std;
-    vector<coord> rtn;
-    for (coord c : coordRectIterator(0,0,level::MAX_WIDTH-1, level::MAX_HEIGHT - 1))
-      if (terrain_.at(c).type() == type) 
-	rtn.emplace_back(c);
-    return rtn;;
+  const std::vector<coord> &findAllTerrain(const terrainType &type) const {
+    return byType_[static_cast<size_t>(type)];
   }
   
   coord findTerrain(const terrainType t, const int width, const int height) const {
@@ -376,7 +767,7 @@ public:
 	  
       found = true;
       for (coord c : coordRectIterator(xPos, yPos, width + xPos-1, height + yPos - 1))
-	if (terrain_.at(c).type() != t) {
+	if (terrain_[c] != t) {
 	  found = false;
 	  break;
 	}
@@ -395,10 +786,9 @@ public:
     const auto tName = target.name();
     const auto &tType = target.type();
     if (aggressor.capture(tPos)) {
-      auto monsters = monsters_.equal_range(tPos);
       std::wstring aName = aggressor.name();
-      auto num = std::distance(monsters.first, monsters.second);
-      capture(aggressor, tPos, monsters.first, monsters.second);
+      auto num = occupantsAt(tPos).size();
+      capture(aggressor, tPos);
       if (num == 1)
 	ioFactory::instance().longMsg(tName + L" is no more thanks to " + aName);
       else
@@ -459,28 +849,58 @@ public:
   }
 
 
-  optionalRef<monster> lineOfSightTarget(monster &m, const coord  &mPos) {
-    if (!m.abilities()->hasSense(sense::SIGHT)) return optionalRef<monster>(); // can't see targets
-    for (auto it = monsters_.begin(); it != monsters_.end(); ++it) {
-      const coord &tPos = it->first;
-      std::shared_ptr<monster> t = it->second; // target monster
-      // don't self-flagellate
-      if (&(*t) == &m) continue;
-      // only non-coaligned monsters attack
-      if (m.align().coalignment(t->align()) >= 3) continue;
-      // never throw into a temple (let's say any zone for ease)
-      auto zones = zonesAt(posOf(*t), true);
-      if (zones.begin() != zones.end()) continue;
-      // skip anyone charming
-      if (std::find_if(m.charmedBegin(), m.charmedEnd(),
-		       [&t](const std::pair<const monster*, const monster*> &p){return p.second == &(*t);}) != m.charmedEnd()) continue;
-      // check for a line of movement
-      coord c;
-      for (c = mPos; c != tPos; c = c.towards(tPos))
-	if (!m.abilities()->move(terrainAt(c)))
-	  break; // give up
-      if (c == tPos) return optionalRef<monster>(*t); // found one!
-    }
+  // straight lines to everywhere a monster might throw or zap at; the full height of the level
+  static const sightLines<level::MAX_HEIGHT> sightLines_;
+
+  /*
+   * The nearest non-coaligned monster within sightLines_'s radius of m
+   * (at mPos) that m could reach in a straight line of moves.
+   * Searches outwards through the occupancy grid a ring at a time, so
+   * stops at the nearest ring with a target, and only walks lines to
+   * squares with someone worth hitting.
+   */
+  optionalRef<monster> lineOfSightTarget(monster &m, const coord &mPos) {
+    auto abilities = m.abilities();
+    if (!abilities->hasSense(sense::SIGHT)) return optionalRef<monster>(); // can't see targets
+    // what m can see; only worked out once there's a candidate
+    const level::viewLayer *seen = nullptr;
+    // can m move through each terrain type? worked out only as needed
+    std::bitset<terrainTypeSize> known, passes;
+    auto clearLine = [&](const int dx, const int dy) {
+      const auto end = sightLines_.end(dx, dy);
+      for (auto s = sightLines_.begin(dx, dy); s != end; ++s) {
+	const coord c(mPos.first + s->first, mPos.second + s->second);
+	const size_t t = static_cast<size_t>(terrain_[c]);
+	if (!known[t]) {
+	  known[t] = true;
+	  passes[t] = abilities->move(terrainAt(c));
+	}
+	if (!passes[t]) return false;
+      }
+      return true;
+    };
+    const deity &malign = m.align();
+    for (int d = 1; d <= sightLines_.radius; ++d)
+      for (int dy = -d; dy <= d; ++dy)
+	// top & bottom rows of the ring in full; just the ends of the others
+	for (int dx = -d; dx <= d; dx += (dy == -d || dy == d) ? 1 : 2*d)
+	  for (monster *t : occupantsAt(coord(mPos.first + dx, mPos.second + dy))) {
+	    // don't self-flagellate
+	    if (t == &m) continue;
+	    // only non-coaligned monsters attack
+	    if (malign.coalignment(t->align()) >= 3) continue;
+	    // never throw into a temple (let's say any zone for ease)
+	    auto zones = zonesAt(posOf(*t), true);
+	    if (zones.begin() != zones.end()) continue;
+	    // skip anyone charming
+	    if (std::find_if(m.charmedBegin(), m.charmedEnd(),
+			     [t](const std::pair<const monster*, const monster*> &p){return p.second == t;}) != m.charmedEnd()) continue;
+	    // can't target what we can't see
+	    if (!seen) seen = &fieldOfView(mPos, sightLines_.radius);
+	    if (!(*seen)[terrain_.index(coord(mPos.first + dx, mPos.second + dy))]) continue;
+	    // check for a line of movement
+	    if (clearLine(dx, dy)) return optionalRef<monster>(*t); // found one!
+	  }
     return optionalRef<monster>(); // no targets found
   }
 
@@ -490,9 +910,9 @@ public:
     if (cc.first < 0 || cc.second < 0 || cc.first == level::MAX_WIDTH || cc.second == level::MAX_HEIGHT)
       return; // can't move above top of map
     if (!movable(c,cc,m,avoidTraps, false)) return; // can't move into terrain
-    auto mn = monsters_.find(cc);
-    while (mn != monsters_.end()) {
-      attack(m, *(mn->second)); // can't move into monster
+    auto &mn = occupantsAt(cc);
+    if (!mn.empty()) {
+      attack(m, *(mn.front())); // can't move into monster
       return;
     }
     if (!m.isPlayer()) {
@@ -500,8 +920,9 @@ public:
       // if there are any, then attack that way.
       auto thrown = thrownWeapon(m);
       auto zapped = zapItem(m);
-      auto target = lineOfSightTarget(m,c); // we only really care if any target exists at this point.
-      if ((thrown || zapped) && target && dPc() <= 40 /* ~ 33% chance */ ) {
+      // only look for a target if we've something to hit it with;
+      // we only really care if any target exists at this point.
+      if ((thrown || zapped) && lineOfSightTarget(m,c) && dPc() <= 40 /* ~ 33% chance */ ) {
 	if (thrown || (thrown && zapped && dPc() <= 50)) {
 	  // lob/fire at the target:
 	  dynamic_cast<useInCombat&>(thrown.value()).useForCombat();
@@ -516,7 +937,7 @@ public:
   }
   void up(monster &m) {
     coord c = posOf(m);
-    switch (terrain_.at(c).type()) {
+    switch (typeAt(c)) {
     case terrainType::UP:
       if (depth_ <= 1) {
 	auto &role = dung().pc()->job();
@@ -529,8 +950,8 @@ public:
       }
       removeMonster(m);
       if (m.isPlayer())
-	dungeon_.upLevel();
-      m.onLevel(&dungeon_.cur_level());
+	dungeon_->upLevel();
+      m.onLevel(&dungeon_->cur_level());
       break;
     default:
       ioFactory::instance().message(L"There is no way up here.");
@@ -538,16 +959,16 @@ public:
   }
   void down(monster &m) {
     coord c = posOf(m);
-    if (depth_ == dungeon_.maxLevel()) {
+    if (depth_ == dungeon_->maxLevel()) {
       ioFactory::instance().message(L"You are already at the bottom of the game.");
       return;
     }
-    switch (terrain_.at(c).type()) {
+    switch (typeAt(c)) {
     case terrainType::DOWN:
       removeMonster(m);
       if (m.isPlayer())
-	dungeon_.downLevel();
-      m.onLevel(&dungeon_.cur_level());
+	dungeon_->downLevel();
+      m.onLevel(&dungeon_->cur_level());
       break;
     default:
       ioFactory::instance().message(L"There is no way down here.");
@@ -563,20 +984,12 @@ public:
   coord posOf(const monster &m) const {
     auto bm = dynamic_cast<const ::bigMonster*>(&m);
     if (bm) return bm->mainPos();
-    for (auto i = monsters_.begin(); i != monsters_.end(); ++i) {
-      if (*(i->second) == m) {
-	return i->first;
-      }
-    }
+    auto o = occupantOf(m);
+    if (o && !o->pos_.empty()) return o->pos_.front();
     return coord(-1,-1);
   }
   const coord pcPos() const {
-    for (auto i = monsters_.begin(); i != monsters_.end(); ++i) {
-      if (i->second->isPlayer()) {
-	return i->first;
-      }
-    }
-    return coord(-1,-1);
+    return pc_ ? posOf(*pc_) : coord(-1,-1);
   }
   optionalRef<monster> findMonster(monster &from, const wchar_t dir) const {
     if (dir == L',') return optionalRef<monster>(from);
@@ -640,17 +1053,12 @@ public:
 
   // find a piece of terrain and move to it (NB: This won't work with Nethack-style branch levels)
   void moveTo(const terrainType terrain) {
-    for (auto i = monsters_.begin(); i != monsters_.end(); ++i) {
-      if (i->second->isPlayer()) {
-	moveTo(*(i->second), findTerrain(terrain));
-	return;
-      }
-    }
+    if (pc_) moveTo(*pc_, findTerrain(terrain));
   }
   // determines if a monster is still alive at the given position.
   bool stillOnLevel(const monster *mon) const {
-    for (auto p : monsters_)
-      if (p.second.get() == mon) return true;
+    if (rosterIdx_.find(mon) != rosterIdx_.end()) return true;
+    countMiss();
     return false;
   }
   // teleport a monster. NB: This will move the monster regardless of any traps, items or other things in the way
@@ -658,72 +1066,56 @@ public:
   void moveTo(monster &m, const coord &dest, dir d = dir(0,0)) {
     auto bm = dynamic_cast<::bigMonster*>(&m);
     if (bm) bm->setPos(dest);
-    // NB: This repeats the loop each time in case any callback removes or moves the monster.
-    zoneActions<monster> zones;
-    for (auto i = monsters_.begin(); i != monsters_.end(); ++i) {
-      auto pM = i->second;
-      if (*pM == m) {
-	zones = zoneActions<monster>(zonesAt(i->first, true), zonesAt(dest, true));
-	for (auto z : zones.same())
-	  if (!z->onMoveWithin(*pM, dest)) return;
-      }
-    }
-    for (auto i = monsters_.begin(); i != monsters_.end(); ++i) {
-      auto pM = i->second;
-      if (*pM == m)
-	for (auto z : zones.leaving())
-	  if (!z->onExit(*pM, holder(dest))) return;
-    }
-    for (auto i = monsters_.begin(); i != monsters_.end(); ++i) {
-      auto pM = i->second;
-      if (*pM == m)
-	for (auto z : zones.entering())
-	  if (!z->onEnter(*pM, holder(i->first))) return;
-    }
-    for (auto i = monsters_.begin(); i != monsters_.end(); ++i) {
-      auto pM = i->second;
-      if (*pM == m) {
-	teleportTo(i, dest, d);
-	return;
-      }
-    }
+    // NB: This looks the monster up each time in case any callback removes or moves the monster.
+    auto o = occupantOf(m);
+    if (!o || o->pos_.empty()) return;
+    auto pM = o->mon_;
+    zoneActions<monster> zones(zonesAt(o->pos_.front(), true), zonesAt(dest, true));
+    for (auto z : zones.same())
+      if (!z->onMoveWithin(*pM, dest)) return;
+    if (!stillOnLevel(&m)) return;
+    for (auto z : zones.leaving())
+      if (!z->onExit(*pM, holder(dest))) return;
+    o = occupantOf(m);
+    if (!o || o->pos_.empty()) return;
+    const coord from = o->pos_.front();
+    for (auto z : zones.entering())
+      if (!z->onEnter(*pM, holder(from))) return;
+    if (!stillOnLevel(&m)) return;
+    teleportTo(pM, dest, d);
   }
   void teleportTo(monster &m, const coord &dest, dir d = dir(0,0)) {
-    std::shared_ptr<monster> pM;
-    auto i = monsters_.begin();
-    while (i != monsters_.end())
-      if (*(i->second) == m) {
-	teleportTo(i, dest, d); //invalidates i
-	return;
-      } else ++i;
-  }
-  void teleportTo(::std::multimap<coord, ::std::shared_ptr<monster> >::iterator i, const coord &dest, dir d = dir(0,0)) {
-    auto pM = i->second;
-    if(pM->onMove(dest, terrain_.at(dest).value(), d)) {
-      if (posOf(*pM).first >= 0) { // in case monster has died/left the level in onMove()
-	monsters_.erase(i);
-	monsters_.emplace(::std::pair<coord, std::shared_ptr<monster> >(dest, pM));
+    auto o = occupantOf(m);
+    if (o) teleportTo(o->mon_, dest, d);
+  }
+  void teleportTo(const std::shared_ptr<monster> pM /* by value, as we may remove it from the roster */, const coord &dest, dir d = dir(0,0)) {
+    if(pM->onMove(dest, terrainAt(dest), d)) {
+      auto o = occupantOf(*pM);
+      // in case monster has died/left the level in onMove();
+      // bigMonsters have already updated their squares in setPos()
+      if (o && !dynamic_cast<::bigMonster*>(pM.get())) {
+	vacateAll(*o);
+	occupy(pM, dest);
       }
       // reveal any pits:
-      if (!pM->abilities()->fly() && terrain_.at(dest).type() == terrainType::PIT_HIDDEN)
-	terrain_[dest] = tFactory.get(terrainType::PIT);
-      if (!pM->abilities()->fly() && terrain_.at(dest).type() == terrainType::SPRINGBOARD_HIDDEN)
-	terrain_[dest] = tFactory.get(terrainType::SPRINGBOARD);      
+      if (!pM->abilities()->fly() && typeAt(dest) == terrainType::PIT_HIDDEN)
+	setTerrain(dest, terrainType::PIT);
+      if (!pM->abilities()->fly() && typeAt(dest) == terrainType::SPRINGBOARD_HIDDEN)
+	setTerrain(dest, terrainType::SPRINGBOARD);
       // any single-shot traps:
-      if (terrain_.at(dest).type() == terrainType::PIANO_HIDDEN)
-	terrain_[dest] = tFactory.get(terrainType::GROUND);
+      if (typeAt(dest) == terrainType::PIANO_HIDDEN)
+	setTerrain(dest, terrainType::GROUND);
       if (pM->isPlayer())
 	describePlayerLoc(*pM, dest);
-      pM->postMove(dest, terrain_.at(dest).value());
+      pM->postMove(dest, terrainAt(dest));
     }
   }
 
   void describePlayerLoc(const monster &m, const coord &pcLoc) const {
     std::vector<std::wstring> msg;
-    auto monsters = monsters_.equal_range(pcLoc);
-    for (auto i = monsters.first; i != monsters.second; ++i)
-      if (*(i->second) != m)
-	msg.emplace_back(L"live " + i->second->name());
+    for (auto pM : occupantsAt(pcLoc))
+      if (*pM != m)
+	msg.emplace_back(L"live " + pM->name());
     auto items = holder(pcLoc);
     items.forEachItem([&msg](const item&, std::wstring name) {
 	msg.emplace_back(name);
@@ -759,7 +1151,7 @@ public:
   }
 
   void changeTerrain(const coord &c, terrainType t) {
-    terrain_[c] = tFactory.get(t);
+    setTerrain(c, t);
   }
   
   bool movable(const coord &oldPos, const coord &pos, const monster &m, bool avoidTraps, bool avoidHiddenTraps) {
@@ -768,7 +1160,7 @@ public:
     if (!v) v = vehicleTransportable(oldPos, t, m);  // moving by vehicle
     if (v) {
       transport &tr = dynamic_cast<transport&>(v.value());
-      tr.isOnLevel(dungeon_[depth_]);
+      tr.isOnLevel((*dungeon_)[depth_]);
       tr.onMonsterMove(oldPos, holder(pos), pos, t);
       vehicleLeaving(oldPos, pos, t);
       return true;
@@ -789,7 +1181,7 @@ private:
     auto &h = holder(pos);
     return h.firstItem([&m, &t, this](item &i) { // returns true if finds any item
 	auto pV = dynamic_cast<transport *>(&i);
-	if (pV) pV->isOnLevel(dungeon_[depth_]);
+	if (pV) pV->isOnLevel((*dungeon_)[depth_]);
 	return pV && m.abilities()->move(pV->terrainFor(t)); // returns item if movable
       });
   }
@@ -798,7 +1190,7 @@ private:
     auto &h = holder(oldPos);
     return h.firstItem([&m, &t, this](item &i) { // returns true if finds any item
 	auto pV = dynamic_cast<transport *>(&i);
-	if (pV) pV->isOnLevel(dungeon_[depth_]);
+	if (pV) pV->isOnLevel((*dungeon_)[depth_]);
 	return pV && pV->moveOnto(t) && m.abilities()->move(pV->terrainFor(t));
       });
   }
@@ -807,16 +1199,14 @@ private:
     auto &h = holder(oldPos);
     h.forEachItem([&oldPos, &pos, &t, this](item &i, std::wstring) { // returns true if finds any item
 	auto pV = dynamic_cast<transport *>(&i);
-	if (pV) pV->isOnLevel(dungeon_[depth_]);
+	if (pV) pV->isOnLevel((*dungeon_)[depth_]);
 	if(pV) pV->onMonsterMove(oldPos, holder(pos), pos, t);
       });
   }
-  void capture(monster &by, coord pos,
-	       std::multimap<coord, std::shared_ptr<monster> >::iterator &from,
-	       std::multimap<coord, std::shared_ptr<monster> >::iterator &to) {
+  void capture(monster &by, coord pos) {
     std::vector<std::shared_ptr<monster>> prey;
-    for (auto p = from; p != to; ++p)
-      prey.emplace_back(p->second);
+    for (auto p : occupantsAt(pos))
+      prey.emplace_back(occupantOf(*p)->mon_);
     by.captured(prey);
     for (auto m : prey) {
       m->death(false);
@@ -833,25 +1223,17 @@ public:
 
     if (!movable(cc,pos, m, avoidTraps, false)) // monster can't pass this way
       return;      // can't move this way.
-    auto toCapture = monsters_.equal_range(pos); // monsters can't *generally* move into each other. When they do, we call it "capturing" (as in chess)
-    if (toCapture.first != toCapture.second && !m.capture(pos))
+    bool toCapture = !occupantsAt(pos).empty(); // monsters can't *generally* move into each other. When they do, we call it "capturing" (as in chess)
+    if (toCapture && !m.capture(pos))
       return;
     if (!avoidTraps || !terrainAt(pos).entraps(m, false)) {// avoid traps if we should & can see them
-      if (toCapture.first != toCapture.second)
-	capture(m, pos, toCapture.first, toCapture.second);
+      if (toCapture)
+	capture(m, pos);
       moveTo(m, pos, dir); // moveTo handles entrapped()
     }
   }
   void removeMonster(const monster &m) {
-    bool isBig = dynamic_cast<const ::bigMonster*>(&m);
-    for (auto i = monsters_.begin(); i != monsters_.end();) {
-      auto erIter = i++; // erased iter would become invalid, so increment first
-      if (*(erIter->second) == m) {
-	monsters_.erase(erIter);
-	if (!isBig)
-	  return;
-      }
-    }
+    unoccupy(m);
   }
   void removeDeadMonster(monster &m, bool allowCorpse) {
     // monster's inventory is dropped
@@ -871,30 +1253,27 @@ public:
     // spawn a ghost occasionally
     const mutation &ghostType = mutationFactory::instance()[mutationType::GHOST];
     if (ghostType.appliesTo(t) && depth() > 20 && dPc() < 105) {
-      auto mon = t.spawn(dungeon_[depth()]);
+      auto mon = t.spawn((*dungeon_)[depth()]);
       mon->mutate(mutationType::GHOST);
       addMonster(mon, c);
     }
   }
   // replace the positions of the monster with what matches its copy.
   void bigMonster(monster &m, std::vector<coord> &pos) {
-    std::shared_ptr<monster> pM;
-    for (auto mn = monsters_.begin(); mn != monsters_.end();)
-      if (mn->second.get() == &m) {
-	pM = mn->second;
-	mn = monsters_.erase(mn);
-      } else ++mn;
+    auto o = occupantOf(m);
+    if (!o) return; // not placed yet
+    auto pM = o->mon_;
+    vacateAll(*o);
     for (auto c : pos)
-      monsters_.emplace(c, pM);
+      occupy(pM, c);
   }
 
 
   void addMonster(const std::shared_ptr<monster> mon, const coord c) {
     auto bm = std::dynamic_pointer_cast<::bigMonster>(mon);
-    auto mn = monsters_.equal_range(c);
-    if (mn.first == mn.second) {
+    if (occupantsAt(c).empty()) {
       // no existing monster; place where requested
-      monsters_.emplace(::std::pair<coord, std::shared_ptr<monster> >(c, mon));
+      occupy(mon, c);
       if (bm) bm->setPos(c);
     } else {
       auto 
@@ -904,16 +1283,15 @@ public:
       for (i.first = std::max(0, c.first - 2); i.first < maxX; ++i.first)
 	for (i.second = std::max(0, c.second - 2); i.second < maxY; ++i.second) {
 	  if (! movable(i,i,*mon, true, true)) continue;
-	  auto mni = monsters_.equal_range(i);
-	  if (mni.first == mni.second) {
+	  if (occupantsAt(i).empty()) {
 	    // free nearby passible space
-	    monsters_.emplace(::std::pair<coord, std::shared_ptr<monster> >(i, mon));
+	    occupy(mon, i);
 	    if (bm) bm->setPos(i);
 	    return;
 	  }
 	}
       // still here; nowhere is suitable; give up and stack 'em up:
-      monsters_.emplace(::std::pair<coord, std::shared_ptr<monster> >(c, mon));
+      occupy(mon, c);
       if (bm) bm->setPos(c);
     }
   }
@@ -926,7 +1304,7 @@ public:
     }
     h.forEachItem([this,pos](item &it, std::wstring name) {
       if (ioFactory::instance().ynPrompt(L"Do you want to collect: " + name + L"?")) {
-	dungeon_.pc()->addItem(it);
+	dungeon_->pc()->addItem(it);
 	//holder(pos).removeItem(pos, it);
 	std::wstring material;
 	switch (it.material()) {
@@ -946,7 +1324,7 @@ public:
 	auto msg = dung().msg()
 	  << sense::TOUCH << L"This feels " + material + L"."
 	  << sense::SIXTH << L"This must be" + material + L".";
-	if (dungeon_.pc()->type().eats(it.material()))
+	if (dungeon_->pc()->type().eats(it.material()))
 	  msg << sense::SMELL << L"It smells edible.";
 	if (it.hasAdjective(L"magnetic"))
 	  msg << sense::MAG << L"It has an attractive property.";
@@ -955,25 +1333,112 @@ public:
   }
 
   std::vector<ref<monster> > monstersAt(const coord &pos) const {
-    auto range = monsters_.equal_range(pos);
     std::vector<ref<monster> > rtn;
-    for (auto i = range.first; i != range.second; ++i)
-      rtn.push_back(*(i->second.get()));
+    for (auto pM : occupantsAt(pos))
+      rtn.push_back(*pM);
     return rtn;
   }
 
   void forEachMonster(std::function<void(monster &)> f) {
+    countScan();
+    countVisit();
     // iterate over a copy, in case a monster moves (eg charmed)
     std::vector<::std::shared_ptr<monster>> monsters;
-    for (auto &p : monsters_)
-      monsters.emplace_back(p.second);
+    for (auto &o : roster_)
+      monsters.emplace_back(o.mon_);
     for (auto &p : monsters)
       f(*p);
   }
 
-  dungeon & dung() { return dungeon_; }
+  // most ticks of dormancy to make up for on arrival:
+  static constexpr unsigned long long maxCatchUp = 100;
+
+  void tick() {
+    const unsigned long long now = time::moveCount();
+    // iterate over a copy, in case a monster moves or dies
+    std::vector<::std::shared_ptr<monster>> monsters;
+    monsters.reserve(roster_.size());
+    countScan();
+    for (auto &o : roster_)
+      monsters.emplace_back(o.mon_);
+    if (now > lastTick_ + 1) {
+      const unsigned long ticks = std::min(now - lastTick_ - 1, maxCatchUp);
+      for (auto &p : monsters)
+	if (stillOnLevel(p.get())) p->catchUp(ticks);
+    }
+    lastTick_ = now;
+    act(now);
+    for (auto &p : monsters)
+      if (stillOnLevel(p.get())) p->onTick();
+  }
+
+  // shares out planning between threads; see level::parallelPlanning()
+  static std::unique_ptr<threadPool> planners_;
+  // smallest share of a batch of plans worth handing to each thread
+  static constexpr size_t minPlansPerThread = 4;
+
+  /*
+   * Let each monster due to act during this tick do so, then requeue it
+   * according to its speed; monsters which aren't due are not visited.
+   * Fast monsters may act several times in the same tick.
+   *
+   * All the monsters due at the same phase plan first (in parallel if we
+   * have planners_), then carry out their plans in the order they were
+   * scheduled; so the result doesn't depend on how planning was shared out.
+   */
+  void act(const unsigned long long now) {
+    const unsigned long long begin = now * phasesPerTick, end = begin + phasesPerTick;
+    std::vector<action> batch;
+    // hold references, in case a monster dies or leaves while acting:
+    std::vector<std::shared_ptr<monster> > mons;
+    std::vector<std::vector<std::function<void()> > > plans;
+    while (!actions_.empty() && actions_.front().due_ < end) {
+      const unsigned long long due = actions_.front().due_;
+      batch.clear();
+      mons.clear();
+      while (!actions_.empty() && actions_.front().due_ == due) {
+	std::pop_heap(actions_.begin(), actions_.end());
+	const action a = actions_.back();
+	actions_.pop_back();
+	auto o = occupantOf(*a.mon_);
+	if (o == nullptr || o->action_ != a.serial_) continue; // stale; the monster has left
+	if (hotFlags_[o - roster_.data()] & hotAsleep) {
+	  // sleepers stay put, so don't bother planning; look again next tick
+	  schedule(*o, std::max(due, begin) + phasesPerTick);
+	  continue;
+	}
+	batch.push_back(a);
+      }
+      std::sort(batch.begin(), batch.end(), [](const action &a, const action &b) {
+	  return a.serial_ < b.serial_;
+	});
+      for (auto &a : batch)
+	mons.emplace_back(occupantOf(*a.mon_)->mon_);
+      plans.clear();
+      plans.resize(mons.size());
+      const std::function<void(size_t)> plan = [&mons, &plans](size_t i) {
+	plans[i] = mons[i]->plan();
+      };
+      // only share out batches big enough to be worth waking the other threads for:
+      if (planners_ && mons.size() >= minPlansPerThread * planners_->size()) {
+	prepareRoutes(mons);
+	planners_->run(mons.size(), plan);
+      } else for (size_t i=0; i < mons.size(); ++i) plan(i);
+      for (size_t i=0; i < mons.size(); ++i) {
+	auto o = occupantOf(*mons[i]);
+	if (o == nullptr || o->action_ != batch[i].serial_) continue; // left (or was moved) before its turn
+	for (auto &f : plans[i]) f();
+	o = occupantOf(*mons[i]);
+	if (o == nullptr) continue;
+	// after a spell of dormancy, carry on from now rather than catching up on missed moves:
+	schedule(*o, std::max(due, begin) + actionDelay(*mons[i]));
+      }
+    }
+  }
+
+  dungeon & dung() { return *dungeon_; }
 
-  const dungeon & dung() const { return dungeon_; }
+  const dungeon & dung() const { return *dungeon_; }
 
   itemHolder &holder(const coord c) {
     auto rtn = holders_.find(c);
@@ -1010,7 +1475,7 @@ public:
       }
       if (found) {
 	coord mid(c.first+1, c.second+1);
-	terrain_.at(mid) = tFactory.get(terrainType::GROUND);
+	setTerrain(mid, terrainType::GROUND);
 	return mid;
       }
     }
@@ -1026,7 +1491,7 @@ public:
       for (coord g : grounds) {
 	if (r.towards(g) == g)
 	  if (dPc() <= 10) {
-	    terrain_[r] = tFactory.get(terrainType::CRACK);
+	    setTerrain(r, terrainType::CRACK);
 	    if (++crackCounter == 10) {
 	      auto mok = monsterTypeRepo::instance()[monsterTypeKey::mokumokuren].spawn(pub);
 	      addMonster(mok, r);
@@ -1059,13 +1524,12 @@ std::pair<coord,coord> levelGen::addRoom() {
   std::uniform_int_distribution<int> yPosD(1,level::MAX_HEIGHT - height - 2);
   int xPos = xPosD(generator), yPos = yPosD(generator);
 
-  auto &ground = tFactory.get(terrainType::GROUND);
   for (int y=0; y < height; ++y) {
     for (int x=0; x < width; ++x) {
       coord c(x + xPos,y + yPos);
       //      std::cout << "placing room at " << c << std::endl;
-      //      std::cout << "terrain was " << level_->terrain_.at(c)->type() << std::endl;
-      level_->terrain_.at(c) = ground;
+      //      std::cout << "terrain was " << level_->typeAt(c) << std::endl;
+      level_->setTerrain(c, terrainType::GROUND);
     }
   }
   //  std::cout << "Added a room " << std::flush;
@@ -1102,11 +1566,10 @@ void levelGen::addShrine(const coord &topLeft, const coord &btmRight, optionalRe
     std::make_shared<shrine>(topLeft, btmRight);
   int xPos = topLeft.first, yPos = topLeft.second;
 
-  auto &ground = tFactory.get(terrainType::GROUND);
   for (int y=0; y < height-1; ++y) {
     for (int x=0; x < width-1; ++x) {
       coord c(x + xPos,y + yPos);
-      level_->terrain_.at(c) = ground;
+      level_->setTerrain(c, terrainType::GROUND);
     }
   }
   itemZone(shr);
@@ -1125,12 +1588,11 @@ void levelGen::addShrine(const coord &topLeft, const coord &btmRight, optionalRe
 void levelGen::addShrine(std::unique_ptr<geometry> &&loc, optionalRef<deity> d) {
   int count=0;
   deity &path = d ? d.value() : rndAlign();
-  auto &ground = tFactory.get(terrainType::GROUND);
   for (int x=0; x < level::MAX_WIDTH; ++x)
     for (int y=0; y < level::MAX_HEIGHT; ++y) {
       coord c(x,y);
       if (loc->contains(c)) {
-	level_->terrain_.at(c) = ground;
+	level_->setTerrain(c, terrainType::GROUND);
 	if (++count == 2)
 	  level_->holder(c).addItem(createHolyBook(d.value()));      
       }
@@ -1170,8 +1632,8 @@ void levelGen::addMonster(std::shared_ptr<monster> m, const coord &c) {
 	break;
       }
     // otherwise make it watery
-    if (!found && level_->terrainAt(c).type() == terrainType::GROUND)
-      level_->terrain_[c] = tFactory.get(terrainType::WATER);
+    if (!found && level_->typeAt(c) == terrainType::GROUND)
+      level_->setTerrain(c, terrainType::WATER);
   }
 }
 
@@ -1192,6 +1654,7 @@ monster &levelGen::addMonster(monsterBuilder &b, const coord &c) {
 
 std::vector<monster *> levelGen::addMonsters(std::vector<std::pair<coord,coord>> coords /*by value*/,
 					     std::function<bool(const monsterType*)> f) {
+  if (!populated()) return std::vector<monster *>();
   std::vector<std::pair<unsigned int, monsterType*>> types =
     spawnMonsters(level_->depth(), coords.size(), f);
   std::vector<monster *> rtn;
@@ -1247,29 +1710,29 @@ void levelGen::addTraps(const std::pair<coord,coord> &coords) {
       std::uniform_int_distribution<int> dx(coords.first.first+1, coords.second.first - 2);
       std::uniform_int_distribution<int> dy(coords.first.second+1, coords.second.second - 2);
       const coord c(dx(generator), dy(generator)); // coords=(0,0)-(2,1) but c=gibberish
-      if (level_->terrain_.at(c).type() == terrainType::GROUND) {
+      if (level_->typeAt(c) == terrainType::GROUND) {
 	switch(dPc() % 12) {
 	case 0:
 	   // at deeper levels, wells become wishing wells. Small chance of a wishing well on level 1, because the first level is hardest.
 	  if (level_->depth_ > 75 || level_->depth_ < 2)
-	    level_->terrain_.at(c) = tFactory.get(terrainType::WISHING_WELL);
+	    level_->setTerrain(c, terrainType::WISHING_WELL);
 	  else
-	    level_->terrain_.at(c) = tFactory.get(terrainType::WELL);
+	    level_->setTerrain(c, terrainType::WELL);
 	  break;
 	case 1:
 	case 2: case 3:
 	case 4: case 5:
 	case 6: case 7:
-	  level_->terrain_.at(c) = tFactory.get(terrainType::PIT_HIDDEN);
+	  level_->setTerrain(c, terrainType::PIT_HIDDEN);
 	  break;
 	case 8: case 9:
-	  level_->terrain_.at(c) = tFactory.get(terrainType::PIANO_HIDDEN);
+	  level_->setTerrain(c, terrainType::PIANO_HIDDEN);
 	  break;
 	case 10:
-	  level_->terrain_.at(c) = tFactory.get(terrainType::SPRINGBOARD);
+	  level_->setTerrain(c, terrainType::SPRINGBOARD);
 	  break;
 	case 11:
-	  level_->terrain_.at(c) = tFactory.get(terrainType::SPRINGBOARD_HIDDEN);
+	  level_->setTerrain(c, terrainType::SPRINGBOARD_HIDDEN);
 	}
       }
     }
@@ -1277,6 +1740,7 @@ void levelGen::addTraps(const std::pair<coord,coord> &coords) {
 }
 
 void levelGen::addItems(const std::pair<coord,coord> &coords) {
+  if (!populated()) return;
   int itemCount = numItems(); // may be < 0, to increase chance of no initial items in a given room
   std::uniform_int_distribution<int> dx(coords.first.first+1, coords.second.first - 2);
   std::uniform_int_distribution<int> dy(coords.first.second+1, coords.second.second - 2);
@@ -1287,10 +1751,13 @@ void levelGen::addItems(const std::pair<coord,coord> &coords) {
   }
 }
 
+bool levelGen::populated() const {
+  return level_->dungeon_ != nullptr;
+}
+
 void levelGen::changeTerrain(coord c, terrainType from, terrainType to) {
-  auto pT = level_->terrain_.find(c);
-  if (pT->second == tFactory.get(from))
-    pT->second = tFactory.get(to);
+  if (level_->typeAt(c) == from)
+    level_->setTerrain(c, to);
 }
 
 coord levelGen::addCorridor(const coord &from, const coord &to) {
@@ -1326,8 +1793,8 @@ void levelGen::place(const iter & begin,
  		    const iter & end,
 		    terrainType type) {
   for (auto i=begin; i != end; ++i) {
-    if (level_->terrainAt(mid(*i)).type() == terrainType::GROUND) {
-      level_->terrain_[mid(*i)] = tFactory.get(type);
+    if (level_->typeAt(mid(*i)) == terrainType::GROUND) {
+      level_->setTerrain(mid(*i), type);
       return;
     }
   }
@@ -1341,24 +1808,27 @@ template<class iter>
 void levelGen::place(iter it,
 		    terrainType type) {
   for (coord c : it)
-    level_->terrain_[c] = tFactory.get(type);
+    level_->setTerrain(c, type);
 }
 
 void levelGen::place(const coord &c, terrainType type) {
-  level_->terrain_[c] = tFactory.get(type);  
+  level_->setTerrain(c, type);
 }
 
 terrainType levelGen::at(const coord &c) const {
-  return level_->terrain_.at(c).type();
+  return level_->typeAt(c);
 }
 
 coord levelGen::findRndTerrain(terrainType t) const {
-  coord c;
-  do {
-    c.first = rndPickI(1, level::MAX_WIDTH-1);
-    c.second = rndPickI(1, level::MAX_HEIGHT-1);
-  } while (at(c) != t);
-  return c;
+  std::vector<coord> inside; // keep off the edges
+  for (auto &c : level_->findAllTerrain(t))
+    if (c.first >= 1 && c.second >= 1 && c.first <= level::MAX_WIDTH-2 && c.second <= level::MAX_HEIGHT-2)
+      inside.push_back(c);
+  if (inside.empty()) {
+    using namespace std;
+    throw wstring(L"Terrain type ") + to_string(t) + wstring(L" not found on level ") + to_wstring(level_->depth_);
+  }
+  return *rndPick(inside.begin(), inside.end());
 }
 
 
@@ -1389,11 +1859,80 @@ bool level::isTerrainAdjacent(const terrainType &t, const coord &c) const {
   return pImpl_->isTerrainAdjacent(t,c);
 }
 
+dir level::towardsPlayer(const monster &m, const coord &from, const dir &prefer) {
+  return pImpl_->towardsPlayer(m, from, prefer);
+}
+
+const level::passLayer &level::passable(const monster &m) {
+  return pImpl_->passable(m);
+}
+
+constexpr unsigned long long levelImpl::maxCatchUp;
+const sightLines<level::MAX_HEIGHT> levelImpl::sightLines_;
+std::unique_ptr<threadPool> levelImpl::planners_;
+
+void level::tick() {
+  pImpl_->tick();
+}
+
+const level::occupancyGrid &level::occupancy() const {
+  return pImpl_->occupants_;
+}
+
+bool level::anyCoaligned(const deity &d) const {
+  return pImpl_->anyCoaligned(d);
+}
+
+void level::monsterChanged(const monster &m) {
+  pImpl_->monsterChanged(m);
+}
+
+#ifdef COUNT_MONSTER_SCANS
+std::atomic<unsigned long> levelImpl::monsterScans_(0);
+std::atomic<unsigned long> levelImpl::monsterVisits_(0);
+std::atomic<unsigned long> levelImpl::rosterMisses_(0);
+
+unsigned long level::monsterScans() {
+  return levelImpl::monsterScans_;
+}
+unsigned long level::monsterVisits() {
+  return levelImpl::monsterVisits_;
+}
+unsigned long level::rosterMisses() {
+  return levelImpl::rosterMisses_;
+}
+#endif //def COUNT_MONSTER_SCANS
+
+void level::parallelPlanning(unsigned int threads) {
+  if (threads > 1) levelImpl::planners_.reset(new threadPool(threads));
+  else levelImpl::planners_.reset();
+}
+
+const level::viewLayer &level::fieldOfView(const coord &viewer, const int radius) const {
+  return pImpl_->fieldOfView(viewer, radius);
+}
+
+bool level::canSee(const coord &viewer, const coord &target, const int radius) const {
+  return pImpl_->canSee(viewer, target, radius);
+}
+
+unsigned long level::terrainGeneration() const {
+  return pImpl_->terrainGeneration();
+}
+
+dir level::towardsTerrain(const monster &m, const coord &from, const terrainType goal, const dir &prefer) {
+  return pImpl_->towardsTerrain(m, from, goal, prefer);
+}
+
+coord level::nearestTerrain(const monster &m, const coord &from, const terrainType goal) {
+  return pImpl_->nearestTerrain(m, from, goal);
+}
+
 coord level::findTerrain(const terrainType &type) const {
   return pImpl_->findTerrain(type);
 }
 
-std::vector<coord> level::findAllTerrain(const terrainType &type) const {
+const std::vector<coord> &level::findAllTerrain(const terrainType &type) const {
   return pImpl_->findAllTerrain(type);
 }
 
@@ -1535,45 +2074,142 @@ coordRectIterator level::allCoords() {
 
 class levelFactoryImpl {
 private:
+  // one level of the dungeon, which may not have been made yet
+  struct slot {
+    std::unique_ptr<level> level_; // owns its levelImpl
+    std::unique_ptr<levelGen> gen_; // refers to level_, so declared after it
+    std::unique_ptr<rngStreams> rng_; // this level's own random numbers
+    bool built_ = false;
+    std::exception_ptr error_; // if building in the background failed
+  };
+  dungeon &dungeon_;
   int numLevels_;
-  std::vector<levelImpl*> levels_;
-  std::vector<level*> levelPubs_;
-  std::vector<std::unique_ptr<levelGen> > levelGen_;
+  std::vector<slot> slots_;
   role &role_;
+  // building in the background; see levelFactory::buildAhead()
+  static bool background_;
+  std::mutex busy_; // held by the player's thread, except while idle
+  std::mutex lock_; // guards wanted_ and stop_
+  std::condition_variable request_;
+  std::deque<int> wanted_; // depths to build, in order
+  bool stop_;
+  std::thread builder_;
 public:
   levelFactoryImpl(dungeon &dungeon, const int numLevels, role &role) : 
+    dungeon_(dungeon),
     numLevels_(numLevels),
-    role_(role) {
-    for (int i=0; i <= numLevels; ++i) {
-      levelImpl *l = new levelImpl(dungeon, i);
-      levels_.push_back(l);
-      levelPubs_.emplace_back(new level(l));
-      auto &level = *(levelPubs_.rbegin());
-      levelGen_.emplace_back(createGen(i, l, level));
+    slots_(numLevels + 1),
+    role_(role),
+    busy_(), lock_(), request_(), wanted_(), stop_(false), builder_() {
+    if (!background_) return;
+    busy_.lock();
+    builder_ = std::thread([this]() { builder(); });
+  }
+  ~levelFactoryImpl() {
+    if (!builder_.joinable()) return;
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      stop_ = true;
     }
-  }
-  void build() {
-    auto begin = levelGen_.begin();
-    auto end = levelGen_.end();
-    for (auto i = begin; i != end; ++i)
-      (*i)->negotiateRamps(
-	 i == end || i+1 == end ? optionalRef<levelGen>() : optionalRef<levelGen>(**(i+1)));
-    int depth=0;
-    auto l = levelPubs_.begin();
-    for (auto i = begin; i != end; ++i) {
-      (*i)->build();
-      for (std::vector<quest>::iterator pQ = role_.questsBegin(); pQ != role_.questsEnd(); ++pQ)
-	pQ->setupLevel(**i, **l, depth);
-      ++depth, ++l;
+    request_.notify_one();
+    busy_.unlock(); // let the builder see stop_
+    builder_.join();
+  }
+  static void buildInBackground(bool b) {
+    background_ = b;
+  }
+  int numLevels() const {
+    return numLevels_;
+  }
+  // the level at the given depth, built on first use
+  level &operator[](const int depth) {
+    slot &s = prepare(depth);
+    if (s.error_) std::rethrow_exception(s.error_);
+    if (!s.built_) build(depth);
+    return *s.level_;
+  }
+  bool built(const int depth) const {
+    return slots_[depth].built_;
+  }
+  void buildAhead(const int depth) {
+    if (!builder_.joinable() || depth < 1 || depth > numLevels_ || slots_[depth].built_) return;
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      wanted_.push_back(depth);
     }
+    request_.notify_one();
   }
-  std::vector<level*>::iterator begin() {
-    return levelPubs_.begin();
+  void beginIdle() {
+    if (builder_.joinable()) busy_.unlock();
   }
-  std::vector<level*>::iterator end() {
-    return levelPubs_.end();
+  void endIdle() {
+    if (builder_.joinable()) busy_.lock();
   }
 private:
+  /*
+   * Build the level at the given depth. Everything it needs is either its
+   * own or reached only while holding busy_ (when there's a builder), so
+   * it may run on either thread.
+   */
+  void build(const int depth) {
+    slot &s = prepare(depth);
+    // we need to know where the level below starts, to put our down ramp above it:
+    optionalRef<levelGen> next;
+    if (depth < numLevels_) next = optionalRef<levelGen>(*prepare(depth + 1).gen_);
+    rngStreamsScope own(*s.rng_);
+    rngScope gen(rngStream::LEVEL);
+    s.gen_->negotiateRamps(next);
+    s.gen_->build();
+    for (std::vector<quest>::iterator pQ = role_.questsBegin(); pQ != role_.questsEnd(); ++pQ)
+      pQ->setupLevel(*s.gen_, *s.level_, depth);
+    if (depth > 50 && dPc() < depth - 50)
+      s.level_->crack();
+    s.built_ = true;
+  }
+  bool stopping() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return stop_;
+  }
+  // the background thread: build each wanted level when the game is idle
+  void builder() {
+    while (true) {
+      int depth;
+      {
+	std::unique_lock<std::mutex> lock(lock_);
+	request_.wait(lock, [this]() { return stop_ || !wanted_.empty(); });
+	if (stop_) return;
+	depth = wanted_.front();
+	wanted_.pop_front();
+      }
+      std::lock_guard<std::mutex> game(busy_);
+      if (stopping()) return;
+      slot &s = slots_[depth];
+      if (s.built_ || s.error_) continue;
+      try {
+	build(depth);
+      } catch (...) {
+	// leave it to the player's thread to report, if they ever get there
+	s.error_ = std::current_exception();
+      }
+    }
+  }
+  /*
+   * Make the (empty) level at the given depth and choose its generator,
+   * if not done already. Each level has its own random numbers, seeded
+   * from the game's seed and its depth, so it comes out the same
+   * whichever order the levels are visited in, and on whichever thread.
+   */
+  slot &prepare(const int depth) {
+    slot &s = slots_[depth];
+    if (s.gen_) return s;
+    s.rng_.reset(new rngStreams(randomSeed(depth)));
+    rngStreamsScope own(*s.rng_);
+    rngScope gen(rngStream::LEVEL);
+    levelImpl *l = new levelImpl(&dungeon_, depth);
+    s.level_.reset(new level(l));
+    s.gen_.reset(createGen(depth, l, s.level_.get()));
+    return s;
+  }
   levelGen *createGen(int depth, levelImpl *l, level *level) {
     for (auto qI = role_.questsBegin(); qI != role_.questsEnd(); ++qI)
       if (qI->isQuestLevel(depth))
@@ -1614,16 +2250,58 @@ private:
   }
 };
 
+bool levelFactoryImpl::background_ = false;
+
 levelFactory::levelFactory(dungeon &dungeon, const int numLevels, role &job) :
-  pImpl_(new levelFactoryImpl(dungeon, numLevels, job)) {
-  pImpl_->build();
+  pImpl_(new levelFactoryImpl(dungeon, numLevels, job)) {}
+
+std::unique_ptr<level> newLayoutLevel(layoutKey key, int depth) {
+  rngScope layout(rngStream::LEVEL);
+  levelImpl *l = new levelImpl(nullptr, depth);
+  std::unique_ptr<level> pub(new level(l)); // owns l
+  std::unique_ptr<levelGen> gen;
+  switch (key) {
+  case layoutKey::ROOM: gen.reset(new roomGen(l, *pub, true)); break;
+  case layoutKey::LABY: gen.reset(new labyGen(l, *pub, true)); break;
+  case layoutKey::LABY_ROOM: gen.reset(new labyRoomGen(l, *pub, true)); break;
+  case layoutKey::LABY_SMALL: gen.reset(new labySmallGen(l, *pub, true)); break;
+  case layoutKey::WATER: gen.reset(newGen(specialLevelKey::WATER, l, pub.get(), true)); break;
+  default: throw key;
+  }
+  gen->negotiateRamps(optionalRef<levelGen>());
+  gen->build();
+  return pub;
+}
+
+std::vector<terrainType> layoutLevel(layoutKey key, int depth) {
+  auto pub = newLayoutLevel(key, depth);
+  std::vector<terrainType> rtn;
+  rtn.reserve(level::MAX_WIDTH * level::MAX_HEIGHT);
+  for (coord c : coordRectIterator(0,0,level::MAX_WIDTH-1, level::MAX_HEIGHT-1))
+    rtn.push_back(pub->terrainAt(c).type());
+  return rtn;
 }
 
-std::vector<level*>::iterator levelFactory::begin() {
-  return pImpl_->begin();
+level &levelFactory::operator[](const int depth) {
+  return (*pImpl_)[depth];
+}
+bool levelFactory::built(const int depth) const {
+  return pImpl_->built(depth);
+}
+int levelFactory::numLevels() const {
+  return pImpl_->numLevels();
+}
+void levelFactory::buildAhead(const int depth) {
+  pImpl_->buildAhead(depth);
+}
+void levelFactory::beginIdle() {
+  pImpl_->beginIdle();
+}
+void levelFactory::endIdle() {
+  pImpl_->endIdle();
 }
-std::vector<level*>::iterator levelFactory::end() {
-  return pImpl_->end();
+void levelFactory::buildInBackground(bool b) {
+  levelFactoryImpl::buildInBackground(b);
 }
 
 // these need to be defined (not just declared) in order to take a reference to them, as in (eg)
@@ -5,21 +5,25 @@
 #ifndef LEVEL_HPP__
 #define LEVEL_HPP__
 
+//#define COUNT_MONSTER_SCANS 1
+
 #include <ostream>
 #include <map>
 #include <vector>
 #include <utility> // for pair
 #include <memory> // for shared_ptr
+#include <bitset>
 
 #include "coord.hpp"
 #include "zone.hpp"
 #include "ref.hpp"
+#include "grid.hpp"
 
 class itemHolder;
 class item;
 class monster;
 class terrain;
-enum class terrainType;
+enum class terrainType : unsigned char;
 enum class monsterTypeKey;
 
 class levelImpl;
@@ -27,18 +31,39 @@ class dungeon;
 class formatter;
 class drawIter;
 class role;
+class deity;
 
 class renderByCoord;
 
 class level;
 class levelFactoryImpl;
+// makes and owns the levels of the dungeon; each is built when first asked for
 class levelFactory {
 private:
   std::shared_ptr<levelFactoryImpl> pImpl_;
 public:
   levelFactory(dungeon &dungeon, const int numLevels, role &);
-  std::vector<level*>::iterator begin();
-  std::vector<level*>::iterator end();
+  // the level at the given depth (0 to numLevels inclusive), building it if need be
+  level &operator[](const int depth);
+  // has the level at the given depth been built yet?
+  bool built(const int depth) const;
+  int numLevels() const;
+  /*
+   * Ask for the level at the given depth to be built in the background,
+   * if it isn't already and buildInBackground() is on; otherwise a no-op.
+   * It comes out the same as if built when first asked for.
+   */
+  void buildAhead(const int depth);
+  /*
+   * The builder only runs while the game is idle (waiting for the player),
+   * so it never shares the game's state with the player's thread. Call
+   * beginIdle() before waiting and endIdle() after, on the player's thread;
+   * endIdle() waits for any level part-way through being built.
+   */
+  void beginIdle();
+  void endIdle();
+  // use a background thread to build levels ahead of the player (for new factories)
+  static void buildInBackground(bool);
 };
 
 class level {
@@ -64,14 +89,15 @@ public:
    */
   bool isTerrainAdjacent(const terrainType &t, const coord &c) const;
   /*
-   * Find any coordinate (probably deterministicly)
+   * Find the first coordinate (in row-major order)
    * with the given terrain type. not a "posOf" as it may not be unique.
    */
   coord findTerrain(const terrainType &type) const;
   /*
-   * Find all the terrain of a given type
+   * Find all the terrain of a given type, in no particular order.
+   * NB: The reference is invalidated by any change of terrain on this level.
    */
-  std::vector<coord> findAllTerrain(const terrainType &type) const;
+  const std::vector<coord> &findAllTerrain(const terrainType &type) const;
   /*
    * Return the postiion of a monster, which may be the player.
    */
@@ -93,7 +119,56 @@ public:
   template <typename T>
   filteredIterable<std::shared_ptr<zoneArea<T> >,std::vector<std::shared_ptr<zoneArea<T> > > > zonesAt(const coord &);
   /*
-   * Syntax sugar for posOf(player)
+   * One bit per square (row-major, so x + y * MAX_WIDTH); set where a monster may move.
+   */
+  typedef std::bitset<MAX_WIDTH * MAX_HEIGHT> passLayer;
+  /*
+   * Squares m will move onto, by terrain alone, avoiding visible traps;
+   * vehicles and other monsters are not considered. Shared between all
+   * monsters with the same movement abilities.
+   * NB: The reference is invalidated by any change of terrain on this level.
+   */
+  const passLayer &passable(const monster &m);
+  /*
+   * Which way should m, at from, step to get closer to the player?
+   * Monsters with the same movement abilities share one distance map,
+   * recalculated only when the player moves or the terrain changes.
+   * prefer breaks ties. Returns dir(0,0) if there is no way closer.
+   */
+  dir towardsPlayer(const monster &m, const coord &from, const dir &prefer);
+  /*
+   * As towardsPlayer, but heading for the nearest square of the goal terrain.
+   * Maps are kept until the terrain changes in a way that affects them.
+   */
+  dir towardsTerrain(const monster &m, const coord &from, const terrainType goal, const dir &prefer);
+  /*
+   * The square of the goal terrain which m, at from, would reach first by
+   * following towardsTerrain(), or coord(-1,-1) if it can't reach any.
+   */
+  coord nearestTerrain(const monster &m, const coord &from, const terrainType goal);
+  /*
+   * One bit per square (row-major, as passLayer); set where visible.
+   */
+  typedef std::bitset<MAX_WIDTH * MAX_HEIGHT> viewLayer;
+  /*
+   * The squares visible from viewer, up to radius moves away, by
+   * shadowcasting over the terrain (see fov.hpp); monsters don't block
+   * sight. Kept by viewer position & radius until the terrain changes,
+   * so everything looking from the same square shares one calculation.
+   * NB: The reference is invalidated by the next call.
+   */
+  const viewLayer &fieldOfView(const coord &viewer, const int radius) const;
+  // can something at viewer see target, up to radius moves away?
+  bool canSee(const coord &viewer, const coord &target, const int radius) const;
+  /*
+   * Incremented whenever any terrain on this level changes, so anything
+   * derived from the terrain can tell when it needs recalculating.
+   * See generationCache in cache.hpp.
+   */
+  unsigned long terrainGeneration() const;
+  /*
+   * Syntax sugar for posOf(player); (-1,-1) if the player is not on this level.
+   * The player is tracked as it arrives and leaves, so this is cheap to call.
    */
   const coord pcPos() const;
   int depth() const;
@@ -140,6 +215,69 @@ public:
    */
   void forEachMonster(std::function<void(monster &)> f);
 
+  // the monsters in each square
+  typedef grid<std::vector<monster *>, MAX_WIDTH, MAX_HEIGHT> occupancyGrid;
+  const occupancyGrid &occupancy() const;
+
+  /*
+   * Call f(monster &, const coord &) for each monster in the 3x3 block
+   * around pos (including pos), straight from the occupancy grid, so
+   * nothing is allocated. Monsters covering several squares are visited
+   * once per square.
+   * NB: f must not move, add or remove monsters; copy what you need first.
+   */
+  template <typename F>
+  void forEachMonsterAdjacent(const coord &pos, F f) const {
+    occupancy().forEachAdjacent(pos, [&f](const std::vector<monster *> &cell, const coord &c) {
+	for (monster *m : cell) f(*m, c);
+      });
+  }
+
+  /*
+   * Is any monster on the level (including the player) coaligned
+   * (coalignment 3 or more) with d? Answered from the level's own copy
+   * of each monster's alignment, without visiting the monsters.
+   */
+  bool anyCoaligned(const deity &d) const;
+
+  /*
+   * Called by a monster when its alignment or sleep changes, so the
+   * level's copy of its per-tick state stays in step.
+   */
+  void monsterChanged(const monster &m);
+
+  /*
+   * Run each monster's per-tick callbacks. Only the player's level is
+   * ticked (by the dungeon); the others lie dormant, and catch up when
+   * the player arrives.
+   */
+  void tick();
+#ifdef COUNT_MONSTER_SCANS
+  /*
+   * How many times, on any level, every monster has been walked over,
+   * whether by a tick (once each), forEachMonster() or anything else.
+   * See bench/scancheck.cpp.
+   */
+  static unsigned long monsterScans();
+  /*
+   * How many of those were forEachMonster() visiting every monster for
+   * its caller (eg a siren singing to the whole level).
+   */
+  static unsigned long monsterVisits();
+  /*
+   * How many times, on any level, a monster was looked up and found not
+   * to be there (eg one which has just died).
+   */
+  static unsigned long rosterMisses();
+#endif //def COUNT_MONSTER_SCANS
+  /*
+   * Monsters due to act at the same moment decide what to do together,
+   * each seeing the level as it was before any of them moved, then move
+   * one at a time in a fixed order. Set how many threads share the
+   * deciding (1 for none); the game plays out the same either way.
+   */
+  static void parallelPlanning(unsigned int threads);
+
   // return a mutable holder for an item on the level
   itemHolder& holder(const item &item);
 
@@ -175,7 +313,7 @@ public:
 
   operator const renderByCoord&() const;
 
-  // find a non-coaligned monster in line of sight:
+  // find the nearest non-coaligned monster in line of sight:
   optionalRef<monster> lineOfSightTarget(monster &m);
 
   // crack the level, eg for an earthquake
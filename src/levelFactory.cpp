@@ -44,8 +44,9 @@ public:
     for (int d=0; d < 4; ++d)
       place(coordRectIterator(3+10*d,3+d,3+10*(d+1),4+d), terrainType::GROUND);
     place(coordRectIterator(40,8,50,10), terrainType::GROUND);
-    for (auto c : coordRectIterator(45,11,45,18))
-      pub_.holder(c).addItem(createItem(itemTypeKey::bridge));
+    if (populated())
+      for (auto c : coordRectIterator(45,11,45,18))
+	pub_.holder(c).addItem(createItem(itemTypeKey::bridge));
     place(coordRectIterator(35,18,55,19), terrainType::GROUND);
     place(coordRectIterator(4,19,60,19), terrainType::GROUND);
     place(coordRectIterator(15,18,22,18), terrainType::GROUND);
@@ -55,6 +56,8 @@ public:
       addShrine();
     }
 
+    if (!populated()) return; // no monsters or items
+
     pub_.holder(coord(1,4)).addItem(createItem(itemTypeKey::ship));
 
     // monsters. Let's start with 5 kelpie and 2 sirens, then half a dozen merfolk:
@@ -5,9 +5,13 @@
 #ifndef LEVELFACTORY_HPP__
 #define LEVELFACTORY_HPP__
 
+#include <memory>
+#include <vector>
+
 class levelImpl;
 class level;
 class levelGen;
+enum class terrainType : unsigned char;
 
 enum class specialLevelKey {
   WATER,
@@ -17,4 +21,28 @@ enum class specialLevelKey {
 
 levelGen *newGen(specialLevelKey, levelImpl *, level *, bool addDownRamp);
 
+// the standard level layouts, for layoutLevel()
+enum class layoutKey {
+  ROOM,
+    LABY,
+    LABY_ROOM,
+    LABY_SMALL,
+    WATER,
+    END
+};
+
+/*
+ * Lay out just the terrain of a level with one of the standard
+ * generators; there is no dungeon, and no monsters or items are added.
+ * Used for benchmarking route-finding (see bench/).
+ * Returns level::MAX_WIDTH * level::MAX_HEIGHT squares in row-major order.
+ * NB: The labyrinth generators throw (char const *) if they fail.
+ */
+std::vector<terrainType> layoutLevel(layoutKey key, int depth);
+/*
+ * As layoutLevel(), but returns the level itself, so its own terrain
+ * queries can be used (see bench/terrainbench).
+ */
+std::unique_ptr<level> newLayoutLevel(layoutKey key, int depth);
+
 #endif // ndef LEVELFACTORY_HPP__
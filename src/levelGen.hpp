@@ -57,7 +57,7 @@ public:
 
   // possibly add some monsters to the room:
   std::vector<monster *> addMonsters(std::vector<std::pair<coord,coord>>,
-				     std::function<bool(const monsterType*)> f = [](const monsterType*){return true;});
+				     std::function<bool(const monsterType*)> f = nullptr);
 
   // possibly add some items to the room:
   void addItems(const std::pair<coord,coord> &);
@@ -97,6 +97,9 @@ public:
 
   terrainType at(const coord &c) const;
 
+  // false if we're only laying out terrain (see layoutLevel()); no monsters or items should be added.
+  bool populated() const;
+
   // as level::findTerrain, but returning any square, not the first.
   // very inefficient for small number of available squares.
   coord findRndTerrain(terrainType t) const;
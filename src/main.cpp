@@ -12,12 +12,13 @@
 #include "itemTypes.hpp"
 #include "args.hpp"
 #include "alien.hpp"
+#include "cache.hpp"
+#include "random.hpp"
 
 #include <iostream>
 #include <sstream>
 #include <memory>
-
-unsigned char dPc(); // avoid including all of random.hpp
+#include <cstdlib> // atoi, strtoull
 
 speed playerSpeed(dungeon &d) {
   return d.pc()->abilities()->adjust(d.pc()->movement().speed_);
@@ -94,10 +95,14 @@ int play(const args &opt) {
       // always draw as the last thing before input; this guarantees that it
       // happens after any other timers.
       d.draw(); 
-      auto ch = io->keyPrompt(L"Your move... (? for help; q to quit) ");
+      std::wstring ch;
+      {
+	dungeon::idle waiting(d); // levels may be built in the background meanwhile
+	ch = io->keyPrompt(L"Your move... (? for help; q to quit) ");
+      }
       processInput(d, ch, io);
     }
-    endDetails = d.score();
+    endDetails = d.score() + L"\n(random seed: " + std::to_wstring(randomSeed()) + L")";
   } else {
     repeat=true;
   }
@@ -344,6 +349,8 @@ int main(int argc, char **argv) {
     args(argc, argv)
     .flag('t').optWithArg("transcript")
     .flag('f').optWithArg("fifos")
+    .optWithArg("threads")
+    .optWithArg("seed")
     .flag('h').flag('?');
 
   if (opt.isFlag('h') || opt.isFlag('?') || opt.option("help")) {
@@ -351,14 +358,24 @@ int main(int argc, char **argv) {
 	       << L"Options are:\n"
 	       << L"h/?/-help - this help text\n"
 	       << L"transcript=<file> - output transcript to file\n"
-	       << L"fifos=<filepath prefix> - for embedding"
+	       << L"fifos=<filepath prefix> - for embedding\n"
+	       << L"threads=<n> - share monster planning between n threads\n"
+	       << L"pregen - build the levels next to yours in the background\n"
+	       << L"seed=<n> - seed the random numbers, to replay a game\n"
+	       << L"stats - report cache usage on exit"
 	       << std::endl;
     return 0;
   }
 
   try {
+    auto seed = opt.option("seed");
+    if (seed) seedRandom(std::strtoull(seed, nullptr, 10));
+    auto threads = opt.option("threads");
+    if (threads) level::parallelPlanning(std::atoi(threads));
+    levelFactory::buildInBackground(opt.option("pregen") != nullptr);
     play(opt);
     cleanup();
+    if (opt.option("stats")) cacheStats::report(std::wcerr);
   } catch (...) {
     cleanup();
     return handleActiveError();
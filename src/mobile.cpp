@@ -8,7 +8,7 @@
 #include "dungeon.hpp"
 #include "religion.hpp"
 #include "terrain.hpp"
-#include "pathfinder.hpp"
+#include "astar.hpp"
 #include "output.hpp"
 #include "target.hpp"
 #include <sstream>
@@ -50,37 +50,36 @@ struct movementTraits<monster> {
 };
 
 
+terrainType seeks(const goTo g) {
+  switch (g) {
+  case goTo::up: return terrainType::UP;
+  case goTo::down: return terrainType::DOWN;
+  case goTo::crack: return terrainType::CRACK;
+  case goTo::web: return terrainType::WEB;
+  default: return terrainType::END;
+  }
+}
+
 template<class T>
-void moveMobile(T &mon) {
+moveIntent planMove(T &mon) {
   level & level = mon.curLevel();
   auto pcPos = level.pcPos();
-  if (pcPos.first < 0) return; // only bother moving if player is on the level.
+  if (pcPos.first < 0) return moveIntent(); // only bother moving if player is on the level.
   const movementType &type = mon.movement();
 
   auto fastness = movementTraits<T>::adjust(mon, type);
   auto myPos = movementTraits<T>::position(level, mon);
 
-  // do we move and - if so - how many times?
-  int loopMax=0;
-  switch (fastness) {
-  case speed::stop: break;
-  case speed::slow3: if ((time::moveCount()) % 3 == 0) ++loopMax; break;
-  case speed::slow2: if ((time::moveCount()) % 2 == 0) ++loopMax; break;
-  case speed::perturn: ++loopMax; break;
-  case speed::turn2: loopMax = 2; break;
-  case speed::turn3: loopMax = 3; break;
-  default: throw type.speed_;
-  }
-
-  auto pMon = &mon;
-  for (int counter = 0; counter < loopMax && level.stillOnLevel(pMon); ++counter) {
+  // how often we move is up to the level (see actionDelay()), but we may not be able to:
+  if (fastness != speed::stop) {
     ::dir dir(0,0);
     coord targetPos;
 
+    terrainType goal = terrainType::END; // terrain we're seeking, if any
     bool charmed = false;
     if (mon.charmedBegin() != mon.charmedEnd()) {
-      auto pM = rndPick(mon.charmedBegin(), mon.charmedEnd());
-      if (dPc() < pM->second->appearance().cur()) {
+      auto pM = rndPick(mon.rng(), mon.charmedBegin(), mon.charmedEnd());
+      if (dPc(mon.rng()) < pM->second->appearance().cur()) {
 	targetPos = level.posOf(*pM->second);
 	dir.first = myPos.first < targetPos.first ? 1 : myPos.first == targetPos.first ? 0 : -1;
 	dir.second = myPos.second < targetPos.second ? 1 : myPos.second == targetPos.second ? 0 : -1;
@@ -90,24 +89,22 @@ void moveMobile(T &mon) {
 
     if (!charmed) switch (type.goTo_) {
     case goTo::none: 
-      return;  // this does not move
+      return moveIntent();  // this does not move
     case goTo::wander:
       {
 	const std::vector<char> dirs({-1, 0, +1 }); // could use boost::counting_iterator here, but I don't want the dependency
-	dir.first = *rndPick(dirs.begin(), dirs.end());
-	dir.second = *rndPick(dirs.begin(), dirs.end());
+	dir.first = *rndPick(mon.rng(), dirs.begin(), dirs.end());
+	dir.second = *rndPick(mon.rng(), dirs.begin(), dirs.end());
       }
       break;
     case goTo::coaligned:
       if (pcPos.first < 0 ||
 	  level.dung().pc()->align().coalignment(mon.align()) >= 3) {
-	mon.curLevel().forEachMonster([&mon, &dir, &level, &targetPos, &pcPos, &myPos](monster &m){
-	    if (m.align().coalignment(mon.align()) >= 3) {
-	      targetPos = pcPos; if (targetPos.first < 0) return; // player is not on this level; skip
-	      dir.first = myPos.first < targetPos.first ? 1 : myPos.first == targetPos.first ? 0 : -1;
-	      dir.second = myPos.second < targetPos.second ? 1 : myPos.second == targetPos.second ? 0 : -1;
-	    }
-	  });
+	if (level.anyCoaligned(mon.align())) {
+	  targetPos = pcPos;
+	  dir.first = myPos.first < targetPos.first ? 1 : myPos.first == targetPos.first ? 0 : -1;
+	  dir.second = myPos.second < targetPos.second ? 1 : myPos.second == targetPos.second ? 0 : -1;
+	}
 	// TODO: Would be nice to move to coaligned zone if no monster exists
 	break;
       } // else fall right through to player
@@ -115,75 +112,65 @@ void moveMobile(T &mon) {
       if (type.goTo_ == goTo::unaligned && (
 	  pcPos.first < 0 ||
 	  level.dung().pc()->align().coalignment(mon.align()) < 3)) {
-	mon.curLevel().forEachMonster([&mon, &dir, &level, &targetPos, &pcPos, &myPos](monster &m){
-	    if (m.align().coalignment(mon.align()) >= 3) {
-	      targetPos = pcPos; if (targetPos.first < 0) return; // player is not on this level; skip
-	      dir.first = myPos.first < targetPos.first ? 1 : myPos.first == targetPos.first ? 0 : -1;
-	      dir.second = myPos.second < targetPos.second ? 1 : myPos.second == targetPos.second ? 0 : -1;
-	    }
-	  });
+	if (level.anyCoaligned(mon.align())) {
+	  targetPos = pcPos;
+	  dir.first = myPos.first < targetPos.first ? 1 : myPos.first == targetPos.first ? 0 : -1;
+	  dir.second = myPos.second < targetPos.second ? 1 : myPos.second == targetPos.second ? 0 : -1;
+	}
       break;
       } // else fall through to goTo::player
     case goTo::player:
-      targetPos = pcPos; if (targetPos.first < 0) return; // player is not on this level; skip
+      targetPos = pcPos; if (targetPos.first < 0) return moveIntent(); // player is not on this level; skip
       {
       dir.first = myPos.first < targetPos.first ? 1 : myPos.first == targetPos.first ? 0 : -1;
       dir.second = myPos.second < targetPos.second ? 1 : myPos.second == targetPos.second ? 0 : -1;
       }
       break;
     case goTo::up:
-      targetPos = level.findTerrain(terrainType::UP); 
-      {
-      dir.first = myPos.first < targetPos.first ? 1 : myPos.first == targetPos.first ? 0 : -1;
-      dir.second = myPos.second < targetPos.second ? 1 : myPos.second == targetPos.second ? 0 : -1;
-      }
-      break;
     case goTo::down:
-      targetPos = level.findTerrain(terrainType::DOWN);
+    case goTo::crack:
+    case goTo::web:
+      goal = seeks(type.goTo_);
+      if (level.findAllTerrain(goal).empty()) return moveIntent(); // nothing to seek
+      // the nearest, by the route the level gives us (see below); if we can't get to any, head for one anyway:
+      targetPos = level.nearestTerrain(mon, myPos, goal);
+      if (targetPos.first < 0) targetPos = level.findTerrain(goal);
       {
       dir.first = myPos.first < targetPos.first ? 1 : myPos.first == targetPos.first ? 0 : -1;
-      dir.second = myPos.second < targetPos.second ? 1 : myPos.second == targetPos.second ? 0 : -1;     
+      dir.second = myPos.second < targetPos.second ? 1 : myPos.second == targetPos.second ? 0 : -1;
       }
       break;
-    case goTo::crack: {
-      auto vec = level.findAllTerrain(terrainType::CRACK);
-      auto pTarget = rndPick(vec.begin(), vec.end());
-      if (pTarget == vec.end()) return;
-      targetPos = *pTarget;
-      {
-      dir.first = myPos.first < targetPos.first ? 1 : myPos.first == targetPos.first ? 0 : -1;
-      dir.second = myPos.second < targetPos.second ? 1 : myPos.second == targetPos.second ? 0 : -1;     
-      }
-      break; }
-    case goTo::web: {
-      auto vec = level.findAllTerrain(terrainType::WEB);
-      auto pTarget = rndPick(vec.begin(), vec.end());
-      if (pTarget == vec.end()) return;
-      targetPos = *pTarget;
-      {
-      dir.first = myPos.first < targetPos.first ? 1 : myPos.first == targetPos.first ? 0 : -1;
-      dir.second = myPos.second < targetPos.second ? 1 : myPos.second == targetPos.second ? 0 : -1;     
-      }
-      break; }
     default:
       throw type.goTo_;
     }
 
     // special case: work out best direction before applying jitter; ignore dir worked out above
-    if (type.goBy_ == goBy::smart) {
-      dir = pathfinder<12>([&level, &mon](const coord &c){
-	  if (c.first < 0 || c.second < 0 ||
-	      c.first >= level::MAX_WIDTH ||
-	      c.second >= level::MAX_HEIGHT)
-	    return false;
-	  return level.movable(c,c,mon,true,false);
-	}).find(myPos, targetPos);
+    // (anything seeking terrain follows the level's routes, however it then goes by them)
+    if (goal != terrainType::END || type.goBy_ == goBy::smart) {
+      ::dir flow(0,0);
+      // everything chasing the player, or seeking the same terrain, shares the same routes:
+      if (goal != terrainType::END) flow = level.towardsTerrain(mon, myPos, goal, dir);
+      else if (targetPos == pcPos) flow = level.towardsPlayer(mon, myPos, dir);
+      if (!(flow == ::dir(0,0))) dir = flow;
+      else if (goal != terrainType::END && level.terrainAt(myPos).type() == goal)
+	dir = ::dir(0,0); // already there
+      else if (type.goBy_ == goBy::smart) {
+	static thread_local astar<12> finder; // one per planning thread
+	auto &pass = level.passable(mon);
+	dir = finder.find(myPos, targetPos, [&pass](const coord &c){
+	    if (c.first < 0 || c.second < 0 ||
+		c.first >= level::MAX_WIDTH ||
+		c.second >= level::MAX_HEIGHT)
+	      return false;
+	    return pass[c.first + c.second * level::MAX_WIDTH];
+	  });
+      }
     }
 
 
     // apply jitter:
     if (type.jitterPc > 0) {
-      auto jit = dPc();
+      auto jit = dPc(mon.rng());
       if (jit < type.jitterPc)
 	switch (jit % 8) {
 	case 0: --dir.first; --dir.second; break;
@@ -203,36 +190,88 @@ void moveMobile(T &mon) {
     if (dir.first < -1) dir.first=-1;
     if (dir.second < -1) dir.second=-1;
 
-    // now move the monster:
+    // now decide how to move the monster:
     switch (type.goBy_) {
     case goBy::avoid:
-      dir.first =- dir.first; dir.second =- dir.second;
-      // no break
-    case goBy::beeline:
-      level.move(mon, dir, true);
-      break;
     case goBy::zomavoid:
       dir.first =- dir.first; dir.second =- dir.second;
-      // no break
-    case goBy::zombeeline:
-      level.move(mon, dir, false);
-      break;
-    case goBy::smart:
-      level.move(mon, dir, true);
-      break;
-    case goBy::teleport:
-      level.moveTo(mon, targetPos);
       break;
     default:
-      throw type.goBy_;
+      break;
     }
+    moveIntent rtn;
+    rtn.moves_ = true;
+    rtn.goBy_ = type.goBy_;
+    rtn.dir_ = dir;
+    rtn.target_ = targetPos;
+    return rtn;
+  }
+  return moveIntent();
+}
+
+template<class T>
+void applyMove(T &mon, const moveIntent &intent) {
+  if (!intent.moves_) return;
+  level & level = mon.curLevel();
+  switch (intent.goBy_) {
+  case goBy::avoid:
+  case goBy::beeline:
+  case goBy::smart:
+    level.move(mon, intent.dir_, true);
+    break;
+  case goBy::zomavoid:
+  case goBy::zombeeline:
+    level.move(mon, intent.dir_, false);
+    break;
+  case goBy::teleport:
+    level.moveTo(mon, intent.target_);
+    break;
+  default:
+    throw intent.goBy_;
   }
 }
 
+template<class T>
+void moveMobile(T &mon) {
+  applyMove(mon, planMove(mon));
+}
+
 void ignored(monster &m) {
   moveMobile<monster>(m);
 }
 
+unsigned int actionDelay(monster &mon) {
+  const movementType &type = mon.movement();
+  switch (movementTraits<monster>::adjust(mon, type)) {
+  case speed::stop: return phasesPerTick; // can't move, but check again next tick in case that changes
+  case speed::slow3: return 3 * phasesPerTick;
+  case speed::slow2: return 2 * phasesPerTick;
+  case speed::perturn: return phasesPerTick;
+  case speed::turn2: return phasesPerTick / 2;
+  case speed::turn3: return phasesPerTick / 3;
+  default: throw type.speed_;
+  }
+}
+
+/*
+ * A vector kept between calls, so we needn't allocate one each time.
+ * If we're re-entered while it's in use, the inner call just gets a new one.
+ */
+template <typename T>
+class scratch {
+private:
+  static std::vector<T> spare_;
+  std::vector<T> buf_;
+public:
+  scratch() : buf_() { buf_.swap(spare_); buf_.clear(); }
+  ~scratch() { buf_.swap(spare_); }
+  scratch(const scratch &) = delete;
+  scratch &operator=(const scratch &) = delete;
+  std::vector<T> &operator*() { return buf_; }
+};
+template <typename T>
+std::vector<T> scratch<T>::spare_;
+
 void monsterAttacks(monster &mon) {
   level & level = mon.curLevel();
 
@@ -245,29 +284,31 @@ void monsterAttacks(monster &mon) {
 
   auto myPos = level.posOf(mon);
   auto &dam = mon.injury();
-  // take a copy, in case (eg a monster dies) the collection changes
-  // - make it a set, in case of big monsters
-  std::map<ref<monster>, coord > monstersAt;
-  for (int dx=-1; dx <= +1; ++dx)
-    for (int dy=-1; dy <= +1; ++dy) {
-      coord pos(myPos.first + dx, myPos.second + dy);
-      auto m = level.monstersAt(pos);
-      for (auto pM : m) monstersAt.emplace(pM, pos);
-    }
-  if (!monstersAt.empty()) {
-    // TODO: this is very clunky. Rework move/combat.
-    for (auto ren : monstersAt) {
-      if (mon.capture(ren.second)) {
-	dir d = myPos.dirTo(ren.second);
-	mon.curLevel().moveOrFight(mon, d, true);
-	return; // don't attack if we can capture (instakill as in chess)
-      }
+  // take a copy, in case (eg a monster dies) the squares change
+  // - only the first square of each big monster
+  scratch<std::pair<monster *, coord> > buf;
+  auto &monstersAt = *buf;
+  bool hostile = false; // anyone not coaligned with us?
+  level.forEachMonsterAdjacent(myPos, [&mon, &monstersAt, &hostile](monster &m, const coord &pos) {
+      if (&m == &mon) return;
+      for (auto &n : monstersAt) if (n.first == &m) return;
+      monstersAt.emplace_back(&m, pos);
+      if (m.align().coalignment(mon.align()) < 3) hostile = true;
+    });
+  if (monstersAt.empty()) return; // nobody near; the usual case
+
+  // TODO: this is very clunky. Rework move/combat.
+  for (auto &ren : monstersAt) {
+    if (mon.capture(ren.second)) {
+      dir d = myPos.dirTo(ren.second);
+      mon.curLevel().moveOrFight(mon, d, true);
+      return; // don't attack if we can capture (instakill as in chess)
     }
   }
+  if (!hostile) return; // nobody to fight (see viableTarget())
   
-  for (auto ren : monstersAt) {
-    ref<monster> ref = ren.first;
-    monster &en = ref.value();
+  for (auto &ren : monstersAt) {
+    monster &en = *ren.first;
     auto pos = ren.second;
     if (!viableTarget(en, mon)) continue;
     std::wstringstream msg;
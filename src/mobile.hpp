@@ -17,10 +17,42 @@
 
 class monster;
 
+// what a mobile has decided to do with its next move
+struct moveIntent {
+  bool moves_; // false to stay put
+  goBy goBy_;
+  dir dir_;
+  coord target_; // for goBy::teleport
+  moveIntent() : moves_(false), goBy_(goBy::beeline), dir_(0,0), target_() {}
+};
+
+/*
+ * Decide on one move, without making it. This only reads the level,
+ * and draws random numbers from the mobile's own rng(), so different
+ * mobiles may plan at the same time on different threads, and get the
+ * same answers whatever order they plan in.
+ */
+template<class T>
+moveIntent planMove(T &mon);
+// the terrain sought by mobiles going to g, or END if g isn't a kind of terrain
+terrainType seeks(const goTo g);
+// make a move decided by planMove()
+template<class T>
+void applyMove(T &mon, const moveIntent &intent);
+// make one move; how often depends on the mobile's speed (see actionDelay())
 template<class T>
 void moveMobile(T &mon);
 void monsterAttacks(monster &mon);
 
+/*
+ * Monsters act in phases, several to a tick, so that monsters of
+ * different speeds can interleave; this must be divisible by 2 and 3.
+ */
+const unsigned int phasesPerTick = 6;
+
+// how many phases until the monster next acts, given its current speed
+unsigned int actionDelay(monster &mon);
+
 
 template <class T>
 struct movementTraits{
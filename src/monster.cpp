@@ -10,11 +10,6 @@
 #include "monstermutation.hpp"
 #include "wish.hpp"
 
-//Roll 2D52-2
-unsigned char dPc() {
-  return static_cast<unsigned char>(d51() + d51() - 2);
-}
-
 // store the charmed monsters outside of the object, otherwise we get
 // into all sorts of shenanigans trying to clear up pointers when the
 // monsters die.
@@ -34,6 +29,9 @@ monster::monster(monsterBuilder & b) :
   male_(b.male_),
   female_(b.female_),
   eachTick_(),
+  eachAction_(),
+  rng_(randomStream(rngStream::AI)()),
+  alarm_(),
   type_(*b.type_),
   align_(b.align_),
   intrinsics_(b.type_->intrinsics()),
@@ -53,6 +51,9 @@ monster::monster(monsterBuilder & b, std::vector<const slot *>slots) :
   male_(b.male_),
   female_(b.female_),
   eachTick_(),
+  eachAction_(),
+  rng_(randomStream(rngStream::AI)()),
+  alarm_(),
   type_(*b.type_),
   align_(b.align_),
   intrinsics_(b.type_->intrinsics()),
@@ -61,8 +62,34 @@ monster::monster(monsterBuilder & b, std::vector<const slot *>slots) :
   mutations_() {}
 
 void monster::eachTick(const std::function<void()> &callback) { 
-  //  eachTick_.emplace_back(new time::callback(true, callback));
-  eachTick_.emplace_back(true, callback);
+  eachTick_.emplace_back(callback);
+}
+
+void monster::onTick() {
+  // by index, in case a callback adds another
+  for (size_t i = 0; i < eachTick_.size(); ++i)
+    eachTick_[i]();
+}
+
+void monster::eachAction(const std::function<std::function<void()>()> &callback) { 
+  eachAction_.emplace_back(callback);
+}
+
+bool monster::acts() const {
+  return !eachAction_.empty();
+}
+
+std::vector<std::function<void()> > monster::plan() {
+  std::vector<std::function<void()> > rtn;
+  rtn.reserve(eachAction_.size());
+  for (auto &a : eachAction_)
+    rtn.emplace_back(a());
+  return rtn;
+}
+
+void monster::act() {
+  for (auto &f : plan())
+    f();
 }
 
 const wchar_t monster::render() const { // delegate to type by default
@@ -115,6 +142,7 @@ const monsterType& monster::type() const { return type_; }
 const deity &monster::align() const { return *align_; }
 bool monster::align(const deity &d) {
   align_ = &d;
+  if (level_) level_->monsterChanged(*this);
   return &d == &align();
 }
 
@@ -124,6 +152,7 @@ bool monster::align(const deity &d) {
  * For other monsters, we should also consider any applicable item attacks.
  */
 const attackResult monster::attack(monster &target) {
+  rngScope combat(rngStream::COMBAT);
   auto weCharm = charmedMonsters.equal_range(this);
   for (auto p = weCharm.first; p != weCharm.second; ++p) {
     const monster *m = p->second;
@@ -213,6 +242,7 @@ damageType monster::unarmedDamageType() const {
 
 // wounding in combat: between 0 and the damage_ stat, averaging 50%, then rounded down:
 int monster::wound(const monster &by, unsigned char reductionPc, const damage & type) {
+  rngScope combat(rngStream::COMBAT);
   long damage = dPc();
   damage *= reductionPc;
   damage /= 100;
@@ -368,54 +398,19 @@ bool monster::sleeping() const {
   return flags_[1];
 }
 
-class monsterAlarm {
-private:
-  monster &m_;
-  std::vector<std::function<void()>> &onDeath_;
-  int ticks_;
-  time::callback fn_;
-  std::vector<std::function<void()>>::iterator od_;
-public:
-  monsterAlarm(monster &m,
-	       std::vector<std::function<void()>> &onDeath,
-	       int ticks) :
-    m_(m),
-    onDeath_(onDeath),
-    ticks_(ticks), fn_(true, std::function<void()>([this]() {
-	  if (--ticks_ == 0) {
-	    m_.awaken();
-	    time::offTick(fn());
-	    m_.onDeath_.erase(od_);
-	    delete this;
-	  }    
-	})) {};
-  monsterAlarm(const monsterAlarm &) = delete;
-public:
-  time::callback &fn() { return fn_; }
-  void od(std::vector<std::function<void()>>::iterator &od) {
-    od_ = od;
-  }
-};
-
 bool monster::sleep(int ticks) {
   if (!abilities()->sleeps()) return false;
   flags_[1] = 1;
-  //  time::onTick([th
-  monsterAlarm *ticker = new monsterAlarm(*this, onDeath_, ticks);
-  auto &fn = ticker->fn();
-  time::onTick(fn);
-  onDeath_.push_back([&fn,ticker]() {
-      time::offTick(fn);
-      delete ticker;
-    });
-  auto ode = onDeath_.end();
-  std::advance(ode, -1);
-  ticker->od(ode);
+  if (level_) level_->monsterChanged(*this);
+  time::cancel(alarm_);
+  alarm_ = time::after(ticks, [this]() { awaken(); });
   return true;
 }
 bool monster::awaken() {
+  time::cancel(alarm_);
   bool rtn = flags_[1];
   flags_[1] = 0;
+  if (rtn && level_) level_->monsterChanged(*this);
   return rtn;
 }
 
@@ -639,7 +634,9 @@ const std::shared_ptr<monsterAbilities> monster::abilities() const {
   return rtn;
 }
 
-monster::~monster() {}
+monster::~monster() {
+  time::cancel(alarm_);
+}
 
 bool monster::operator == (const monster &rhs) { return this == &rhs; }
 
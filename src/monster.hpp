@@ -18,6 +18,7 @@
 #include "equippable.hpp"
 #include "hasAdjectives.hpp"
 #include "monstermutation.hpp"
+#include "random.hpp" // xoshiro256
 
 #include <memory> // shared_ptr
 #include <list>
@@ -57,7 +58,13 @@ private:
   characteristic damage_;
   characteristic male_;
   characteristic female_;
-  std::list<time::callback> eachTick_;
+  std::vector<std::function<void()> > eachTick_;
+  // each returns what the monster will do when it acts; see plan()
+  std::vector<std::function<std::function<void()>()> > eachAction_;
+  // random numbers for planning; separate per monster, so plans don't depend on who planned first
+  xoshiro256 rng_;
+  // wakes us from sleep()
+  time::timer alarm_;
   const monsterType & type_;
   // align stored as a non-null pointer, not a reference, so we can always reassign it (permanent alignment change)
   // Smart pointer is not needed as gods are effectively a bunch of create-on-demand singletons
@@ -75,10 +82,37 @@ protected:
   monster(monsterBuilder & b, std::vector<const slot *>slots);
 public:
   /*
-   * Passed a callback, which will be invoked each tick and discarded
-   * when this monster is
+   * Passed a callback, which will be invoked each tick while this
+   * monster is on the player's level, and discarded when this monster is
    */
   void eachTick(const std::function<void()> &callback);
+  // invoke the eachTick() callbacks; called by the level
+  void onTick();
+  /*
+   * Passed a callback, which will be invoked whenever this monster gets
+   * to act on the player's level; how often depends on its speed.
+   * The callback only decides what to do, returning a function to do it;
+   * see plan().
+   */
+  void eachAction(const std::function<std::function<void()>()> &callback);
+  // does this monster have any eachAction() callbacks?
+  bool acts() const;
+  /*
+   * Invoke the eachAction() callbacks, returning what each would do.
+   * Plans must not change the level, as the level may plan for several
+   * monsters at once on different threads; see level::parallelPlanning().
+   */
+  std::vector<std::function<void()> > plan();
+  // plan, then carry out the plans straight away
+  void act();
+  // random numbers for use while planning
+  xoshiro256 &rng() { return rng_; }
+  /*
+   * Called by the level when the player arrives, for time spent while
+   * the level was dormant (capped; see level::tick()). Monsters with
+   * state that changes over time should advance it here.
+   */
+  virtual void catchUp(unsigned long ticks) {}
   virtual const wchar_t render() const; // delegate to type by default
   virtual std::wstring name() const; // delegate to type depending on level by default;
   virtual bool highlight() const;
@@ -322,9 +356,9 @@ public:
 template<monsterTypeKey T>
 std::shared_ptr<monster> ofType(monsterBuilder &b = monsterBuilder(true));
 
+// f, if given, further limits the types of monster to spawn
 std::vector<std::pair<unsigned int, monsterType*>>
 spawnMonsters(int depth, int rooms,
-	      std::function<bool(const monsterType*)> = [](const monsterType *){
-		return true;});
+	      std::function<bool(const monsterType*)> f = nullptr);
 
 #endif // ndef MONSTER_HPP
@@ -18,6 +18,7 @@
 #include <cmath> // for std::ceil
 #include <ctime> // for dates
 #include <bitset>
+#include <algorithm> // copy_if
 
 monsterBuilder::monsterBuilder(bool allowRandom) : 
   level_(NULL),
@@ -216,38 +217,45 @@ public:
 };
 
 // blobs start on one square and blob outwards {
-class blob : public trivialMonster, public bigMonster, private temporal::callback {
+class blob : public trivialMonster, public bigMonster {
 private:
   std::vector<coord> pos_;
+  // blobs spread one square per growth, so would have crossed the level by now
+  static constexpr unsigned long maxGrowth = level::MAX_WIDTH + level::MAX_HEIGHT;
+  void grow() {
+    dir nsew;
+    switch (dPc() % 4) {
+    default: nsew = dir(-1,0); break;
+    case 1: nsew = dir(1,0); break;
+    case 2: nsew = dir(0,-1); break;
+    case 3: nsew = dir(0,1); break;
+    }
+    std::vector<coord> newPos;
+    for (coord c : pos_) {
+      coord cc = c.inDir(nsew);
+      if (cc.first < 0 || cc.second < 0 ||
+          cc.first >= level::MAX_WIDTH || cc.second >= level::MAX_HEIGHT)
+        return;
+      if (std::find(pos_.begin(), pos_.end(), cc) == pos_.end() &&
+          abilities()->move(curLevel().terrainAt(cc)))
+        newPos.push_back(cc);
+    }
+    std::copy(newPos.begin(), newPos.end(), back_inserter(pos_));
+    curLevel().bigMonster(*this, pos_);
+  }
 public:
   blob(monsterBuilder &b) :
     trivialMonster(b),
     bigMonster(),
-    temporal::callback(true, [this](){
-	dir nsew;
-	switch (dPc() % 4) {
-	default: nsew = dir(-1,0); break;
-	case 1: nsew = dir(1,0); break;
-	case 2: nsew = dir(0,-1); break;
-	case 3: nsew = dir(0,1); break;
-	}
-	std::vector<coord> newPos;
-	for (coord c : pos_) {
-	  coord cc = c.inDir(nsew);
-	  if (cc.first < 0 || cc.second < 0 ||
-	      cc.first >= level::MAX_WIDTH || cc.second >= level::MAX_HEIGHT)
-	    return;
-	  if (std::find(pos_.begin(), pos_.end(), cc) == pos_.end() &&
-	      abilities()->move(curLevel().terrainAt(cc)))
-	    newPos.push_back(cc);
-	}
-	std::copy(newPos.begin(), newPos.end(), back_inserter(pos_));
-	curLevel().bigMonster(*this, pos_);
-      }),
     pos_() {
-    time::onTick(*this);
+    eachTick([this](){ grow(); });
   }
   virtual ~blob() {}
+  // blobs keep spreading while nobody is watching:
+  virtual void catchUp(unsigned long ticks) {
+    for (unsigned long i = 0; i < ticks && i < maxGrowth; ++i)
+      grow();
+  }
   // INTERFACE bigMonster
   // called when position is first set, or on teleport:
   virtual void setPos(const coord &c) {
@@ -1379,13 +1387,16 @@ std::shared_ptr<monster> ofType(monsterBuilder &b) {
   const int levelOffset = type.getLevelOffset();
   b.progress(std::max(1, level.depth() - levelOffset) * levelFactor);
 
-  // invoke move() every move, even when the player is helpless:
+  // move as often as our speed allows, and attack every move, even when the player is helpless:
   std::shared_ptr<monster> ptr = std::make_shared<M>(b);
   // pass by value works, but creates an extra 2 persistent refs, causing a memory leak as the ref-count never hits 0.
   // pass by reference causes a SIGSEGV; not sure why.
   // you can't create a second shared_ptr on the same pointer.
   auto &m = *ptr;
-  ptr->eachTick([&m]() {moveMobile<monster>(m);} );
+  ptr->eachAction([&m]() {
+      const moveIntent intent = planMove<monster>(m);
+      return std::function<void()>([&m, intent]() { applyMove<monster>(m, intent); });
+    });
   ptr->eachTick([&m]() {monsterAttacks(m);} );
   equipMonster(type.type(), level, *ptr);
 
@@ -1406,22 +1417,34 @@ std::shared_ptr<monster> ofType(monsterBuilder &b) {
   return ptr;
 }
 
+// the monster types that may be randomly spawned at each depth; the
+// rules only depend on the depth, so each list is only worked out once.
+static const std::vector<monsterType*> &spawnable(int depth) {
+  static std::vector<std::pair<bool, std::vector<monsterType*>>> byDepth;
+  if (depth < 0) depth = 0;
+  if (byDepth.size() <= static_cast<size_t>(depth)) byDepth.resize(depth + 1);
+  auto &rtn = byDepth[depth];
+  if (rtn.first) return rtn.second;
+  for (monsterType *mt : monsterTypeRepo::instance())
+    // Dungeoneers aren't found below level 3 (Ref: Knightmare, which had only 3 levels)
+    if ((depth <= 3 || mt->type() != monsterTypeKey::dungeoneer) &&
+	// don't randomnly generate sirens; they must be on watery levels, on the rocks:
+	mt->type() != monsterTypeKey::siren &&
+	// likewise, don't generate merfolk outside the water:
+	mt->type() != monsterTypeKey::merfolk &&
+	// likewise, don't generate mokumokuren; they come from cracked levels
+	mt->type() != monsterTypeKey::mokumokuren &&
+	depth >= mt->getLevelOffset()) // TODO: unsure if this is being used consistently
+      rtn.second.push_back(mt);
+  rtn.first = true;
+  return rtn.second;
+}
+
 std::vector<std::pair<unsigned int, monsterType*>> spawnMonsters(int depth, int rooms,
    std::function<bool(const monsterType*)> f) {
-  auto from = monsterTypeRepo::instance().begin();
-  auto to = monsterTypeRepo::instance().end();
-  auto filter = [depth,f](monsterType* mt) {
-    // Dungeoneers aren't found below level 3 (Ref: Knightmare, which had only 3 levels)
-      return (depth <= 3 || mt->type() != monsterTypeKey::dungeoneer) &&
-      // don't randomnly generate sirens; they must be on watery levels, on the rocks:
-      mt->type() != monsterTypeKey::siren &&
-      // likewise, don't generate merfolk outside the water:
-      mt->type() != monsterTypeKey::merfolk &&
-      // likewise, don't generate mokumokuren; they come from cracked levels
-      mt->type() != monsterTypeKey::mokumokuren &&
-      f(mt);
-  };
-  auto ffrom = make_filtered_iterator(filter, from, to);
-  auto tto = make_filtered_iterator(filter, to, to);
-  return rndGen<monsterType*, filtered_iterator<std::vector<monsterType*>::iterator > >(ffrom, tto, depth, rooms);
+  auto &all = spawnable(depth);
+  if (!f) return rndGen(all, rooms);
+  std::vector<monsterType*> filtered;
+  std::copy_if(all.begin(), all.end(), std::back_inserter(filtered), f);
+  return rndGen(filtered, rooms);
 }
@@ -55,8 +55,16 @@ public:
   std::map<damageType *, char> extraDamageLevel_;
   std::map<terrainType, bool> terrainMove_;
   int carryWeightN_;
+  // bumped on each change to terrainMove_ or flying
+  unsigned long moveGeneration_;
   monsterIntrinsicsImpl() :
-    damageProof_(), turnsToEscape_(0), bonuses_(), resistLevel_(), extraDamageLevel_(), terrainMove_() {
+    damageProof_(), turnsToEscape_(0), bonuses_(), resistLevel_(), extraDamageLevel_(), terrainMove_(), moveGeneration_(0) {
+    // fill in the defaults now, so lookups never insert; intrinsics are shared
+    // between all monsters of a type, and may be read from several threads at once
+    for (int b = 0; b < static_cast<int>(bonusType::END); ++b)
+      bonuses_[static_cast<bonusType>(b)] = bonus();
+    for (size_t t = 0; t < terrainTypeSize; ++t)
+      terrainMove_[static_cast<terrainType>(t)] = false;
     // all creatures move on ground by default:
     terrainMove_[terrainType::ROCK] = false;
     terrainMove_[terrainType::GROUND] = true;
@@ -157,6 +165,7 @@ const char monsterIntrinsics::extraDamage(const damage & type) const {
 // can you move through a given terrain?
 void monsterIntrinsics::move(const terrain & type, const bool isMove) {
   pImpl_->terrainMove_[type.type()] = isMove;
+  ++pImpl_->moveGeneration_;
 }
 const bool monsterIntrinsics:: move(const terrain & type) const {
   return pImpl_->terrainMove_[type.type()];
@@ -187,10 +196,14 @@ void monsterIntrinsics::sense(const sense::sense &t, const bool value) {
 // can you fly?
 void monsterIntrinsics::fly(const bool fly) {
   pImpl_->bonuses_[bonusType::flying] = bonus(fly);
+  ++pImpl_->moveGeneration_;
 }
 const bool monsterIntrinsics:: fly() const {
   return pImpl_->bonuses_[bonusType::flying] == bonus(true);
 }
+unsigned long monsterIntrinsics::moveGeneration() const {
+  return pImpl_->moveGeneration_;
+}
 // are you trapped right now?
 void monsterIntrinsics::entrap(const int turnsToEscape) {
   pImpl_->turnsToEscape_ += turnsToEscape;
@@ -305,6 +318,7 @@ const char monsterAbilityMods::extraDamage(const damage & type) const {
   // can you move through a given terrain?
 void monsterAbilityMods::move(const terrain & type, const bool isMove) {
   mod_->terrainMove_[type.type()] = isMove;
+  ++mod_->moveGeneration_;
 }
 const bool monsterAbilityMods::move(const terrain & type) const {
   return intrinsics_->move(type) || mod_->terrainMove_[type.type()];
@@ -347,9 +361,14 @@ void monsterAbilityMods::sense(const sense::sense &t, const bonus value) {
 // can you fly?
 void monsterAbilityMods::fly(const bool canFly) {
   mod_->bonuses_[bonusType::flying] = canFly;
+  ++mod_->moveGeneration_;
 }
 const bool monsterAbilityMods::fly() const {
   return intrinsics_->fly() || mod_->bonuses_[bonusType::flying] == bonus(true);
+}
+// both only ever increase, so the sum changes if either does
+unsigned long monsterAbilityMods::moveGeneration() const {
+  return mod_->moveGeneration_ + intrinsics_->moveGeneration();
 }
   // affected by petrify/fear actions? (false = double effect)
 void monsterAbilityMods::fearless(const bonus &fearless) {
@@ -382,13 +401,12 @@ const bonus monsterAbilityMods::speedy() const {
 // adjust the given enum based on the speed bonus/penalty
 // NB: For each 3000N (~1/3tonne, in Earth gravity) the monster carries,
 // rate is reduced by 1 slot. This means a human warrier can carry about a tonne.
+// (Mutations which change carryWeightN() also replace adjust(), so we needn't go through abilities().)
 speed monsterAbilityMods::adjust(const speed & fastness) {
-  const monster* mon = dynamic_cast<const monster*>(&mon_);
-  auto w = mon ? mon->abilities()->carryWeightN() : 3000;
-  const bonus & s = speedy();
+  const int w = carryWeightN();
+  const bonus s = speedy();
+  double totalWeight=mon_.totalWeight(); // cached by itemHolder
   auto rtn = adjustSpeed(s, fastness);
-  double totalWeight=mon_.totalWeight();
-  
   while (totalWeight > w && rtn != speed::stop) {
     rtn = static_cast<speed>(static_cast<int>(rtn)-1);
     totalWeight -= w;
@@ -47,6 +47,8 @@ public:
   // can you fly?
   virtual void fly(const bool canFly) = 0;
   virtual const bool fly() const = 0;
+  // changes whenever move() or fly() might give a different answer, so callers can cache them
+  virtual unsigned long moveGeneration() const = 0;
   // affected by petrify/fear actions? (false = double effect)
   virtual void fearless(const bonus &fearless) = 0;
   virtual const bonus fearless() const = 0;
@@ -114,6 +116,8 @@ public:
   // can you fly?
   virtual void fly(const bool canFly);
   virtual const bool fly() const;
+  // changes whenever move() or fly() might give a different answer, so callers can cache them
+  virtual unsigned long moveGeneration() const;
   // affected by petrify/fear actions? (false = double effect)
   virtual void fearless(const bonus &fearless);
   virtual const bonus fearless() const;
@@ -184,6 +188,8 @@ public:
   // can you fly?
   virtual void fly(const bool canFly);
   virtual const bool fly() const;
+  // changes whenever move() or fly() might give a different answer, so callers can cache them
+  virtual unsigned long moveGeneration() const;
   // affected by petrify/fear actions? (false = double effect)
   virtual void fearless(const bonus &fearless);
   virtual const bonus fearless() const;
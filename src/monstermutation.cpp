@@ -58,6 +58,8 @@ class delegatingAbilities : public monsterAbilities {
   virtual const bool hasSense(const sense::sense &t) const { return d_->hasSense(t); };
   virtual void fly(const bool canFly) { d_->fly(canFly); }
   virtual const bool fly() const { return d_->fly(); }
+  // each mutation may change movement, so counts as a change in itself (mutations are only ever added)
+  virtual unsigned long moveGeneration() const { return d_->moveGeneration() + 1; }
   virtual void fearless(const bonus &fearless) { d_->fearless(fearless); }
   virtual const bonus fearless() const { return d_->fearless(); }
   virtual void entrap(const int ticksToEscape) { d_->entrap(ticksToEscape); }
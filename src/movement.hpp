@@ -22,8 +22,8 @@ enum class goTo {
   unaligned, // seek out the player if unaligned, or any unaligned monster, elso stay put.
   up, // find an up ramp and sit on it
   down, // find a down ramp and sit on it
-  crack, // find any crack terran at random, not necessarily the one we're on
-  web, // find any web terran at random, not necessarily the one we're on
+  crack, // find the nearest crack terrain
+  web, // find the nearest web terrain
 };
 
 enum class goBy {
@@ -0,0 +1,134 @@
+/* License and copyright go here*/
+
+// Random numbers
+
+#include "random.hpp"
+#include <bitset>
+#include <ctime>
+
+void xoshiro256::seed(uint64_t seed) {
+  for (auto &s : s_) {
+    uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    s = z ^ (z >> 31);
+  }
+}
+
+void xoshiro256::jump() {
+  static constexpr uint64_t poly[] = {
+    0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+  };
+  uint64_t s[4] = {0, 0, 0, 0};
+  for (auto p : poly)
+    for (int b = 0; b < 64; ++b) {
+      if (p & (1ULL << b))
+	for (int i = 0; i < 4; ++i) s[i] ^= s_[i];
+      (*this)();
+    }
+  for (int i = 0; i < 4; ++i) s_[i] = s[i];
+}
+
+// we're a game, not a crypto, so seeding with the time should be okay.
+// NB: I'm hashing the time to make it more random; otherwise on Linux/g++, we always get the first few high bits in the first result, leading to the same options being picked.
+static uint64_t timeSeed() {
+  constexpr std::hash<std::bitset<sizeof(time_t)*8>> hasher;
+  return hasher(std::bitset<sizeof(time_t)*8>(time(nullptr)));
+}
+
+rngStreams::rngStreams(uint64_t seed) {
+  xoshiro256 e(seed);
+  for (auto &s : engines_) {
+    s = e;
+    e.jump();
+  }
+}
+
+class streams {
+public:
+  uint64_t seed_;
+  rngStreams engines_;
+  streams() : seed_(timeSeed()), engines_(seed_) {}
+  void reseed(uint64_t seed) {
+    seed_ = seed;
+    engines_ = rngStreams(seed);
+  }
+  // function-local so it's ready for any static initialisers that roll dice
+  static streams &instance() {
+    static streams s;
+    return s;
+  }
+};
+
+uint64_t randomSeed() {
+  return streams::instance().seed_;
+}
+
+uint64_t randomSeed(uint64_t key) {
+  // mix the key (as splitmix64) so that nearby keys give unrelated seeds:
+  uint64_t z = key + 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return randomSeed() ^ z ^ (z >> 31);
+}
+
+void seedRandom(uint64_t seed) {
+  streams::instance().reseed(seed);
+}
+
+// the set of streams in use on this thread; nullptr for the game's own
+static thread_local rngStreams *set_ = nullptr;
+
+xoshiro256 &randomStream(rngStream s) {
+  return (set_ ? *set_ : streams::instance().engines_)[s];
+}
+
+static thread_local rngStream current_ = rngStream::GENERAL;
+// the engine for current_, once looked up
+static thread_local xoshiro256 *engine_ = nullptr;
+
+rngScope::rngScope(rngStream s) :
+  prev_(current_) {
+  current_ = s;
+  engine_ = &randomStream(s);
+}
+
+rngScope::~rngScope() {
+  current_ = prev_;
+  engine_ = &randomStream(prev_);
+}
+
+rngStreamsScope::rngStreamsScope(rngStreams &s) :
+  prev_(set_) {
+  set_ = &s;
+  engine_ = &randomStream(current_);
+}
+
+rngStreamsScope::~rngStreamsScope() {
+  set_ = prev_;
+  engine_ = &randomStream(current_);
+}
+
+currentStream::result_type currentStream::operator()() {
+  if (!engine_) engine_ = &randomStream(current_);
+  return (*engine_)();
+}
+
+currentStream generator;
+
+static int between(const int from, const int to) {
+  std::uniform_int_distribution<int> d(from, to);
+  return d(generator);
+}
+
+int numRooms() { return between(3, 5); }
+int roomWidth() { return between(5, 10); }
+int roomHeight() { return between(3, 6); }
+int coinFlip() { return between(0, 1); }
+int corridorDir() { return between(0, 1); }
+int numItems() { return between(-4, 4); }
+
+//Roll 2D52-2
+unsigned char dPc() {
+  return dPc(generator);
+}
@@ -2,33 +2,143 @@
 
 // Random numbers
 
-#include <ctime>
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+
+#include <cstdint>
+#include <cstdlib> // abs
 #include <random>
 #include <iterator>
 #include <functional>
-#include <bitset>
-
-// we're a game, not a crypto, so seeding with the time should be okay.
-//static std::default_random_engine generator(1473628262);
-constexpr std::hash<std::bitset<sizeof(time_t)>> hasher;
-// NB: I'm hashing the time to make it more random; otherwise on Linux/g++, we always get the first few high bits in the first result, leading to the same options being picked.
-static std::default_random_engine generator(hasher(std::bitset<sizeof(time_t)>(time(nullptr))));
-static std::uniform_int_distribution<int> distributionRoom(3,5);
-static auto numRooms = std::bind ( distributionRoom, generator );
-static std::uniform_int_distribution<int> distributionWidth(5,10);
-static auto roomWidth = std::bind ( distributionWidth, generator );
-static std::uniform_int_distribution<int> distributionHeight(3,6);
-static auto roomHeight = std::bind ( distributionHeight, generator );
-static std::uniform_int_distribution<int> distributionCoinFlip(0,1);
-static auto coinFlip = std::bind ( distributionCoinFlip, generator );
-static auto corridorDir = std::bind ( distributionCoinFlip, generator );
-static std::uniform_int_distribution<int> distributionMonstersPerRoom(-2,2);
-static auto numMonsters = std::bind ( distributionMonstersPerRoom, generator );
-static std::uniform_int_distribution<int> distributionItemsPerRoom(-4,4);
-static auto numItems = std::bind ( distributionItemsPerRoom, generator );
-
-static std::uniform_int_distribution<int> distribution52(1,51);
-static auto d51 = std::bind ( distribution52, generator );
+
+/*
+ * xoshiro256** (Blackman & Vigna): a small, fast generator with 256 bits
+ * of state, plenty for a game. Meets the UniformRandomBitGenerator
+ * concept, so any of the standard distributions can draw from it.
+ */
+class xoshiro256 {
+private:
+  uint64_t s_[4];
+  static uint64_t rotl(const uint64_t x, const int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+public:
+  typedef uint64_t result_type;
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return UINT64_MAX; }
+  explicit xoshiro256(uint64_t seed = 0) { this->seed(seed); }
+  // fill the state from a single number (with splitmix64, as recommended)
+  void seed(uint64_t seed);
+  result_type operator()() {
+    const uint64_t rtn = rotl(s_[1] * 5, 7) * 9;
+    const uint64_t t = s_[1] << 17;
+    s_[2] ^= s_[0];
+    s_[3] ^= s_[1];
+    s_[1] ^= s_[2];
+    s_[0] ^= s_[3];
+    s_[2] ^= t;
+    s_[3] = rotl(s_[3], 45);
+    return rtn;
+  }
+  // skip ahead 2^128 numbers; used to split one seed into non-overlapping streams
+  void jump();
+};
+
+/*
+ * Separate streams for each part of the game, so that (for example)
+ * a change to the combat rules doesn't change the layout of the levels
+ * generated from a given seed.
+ */
+enum class rngStream {
+  GENERAL, // anything not listed below
+    LEVEL, // level layout and population
+    AI, // seeds each monster's own engine (see monster::rng())
+    COMBAT, // attacks and wounds
+    LOOT, // random items and shop stock
+    END
+};
+
+// one engine for each stream, all split from one seed
+class rngStreams {
+private:
+  xoshiro256 engines_[static_cast<int>(rngStream::END)];
+public:
+  explicit rngStreams(uint64_t seed);
+  xoshiro256 &operator[](rngStream s) { return engines_[static_cast<int>(s)]; }
+};
+
+// the seed in use; taken from the time unless seedRandom() is called
+uint64_t randomSeed();
+/*
+ * A seed for the given key (eg a level's depth), derived from
+ * randomSeed(). Anything made from its own rngStreams seeded this way
+ * comes out the same whatever order it's made in.
+ */
+uint64_t randomSeed(uint64_t key);
+// restart every stream from the given seed (eg from -seed=<n>)
+void seedRandom(uint64_t seed);
+// the engine behind the given stream (in the innermost rngStreamsScope on this thread, if any)
+xoshiro256 &randomStream(rngStream s);
+
+/*
+ * Draw every stream (on this thread) from the given set while in
+ * scope, rather than from the game's own.
+ */
+class rngStreamsScope {
+private:
+  rngStreams *const prev_;
+public:
+  explicit rngStreamsScope(rngStreams &s);
+  ~rngStreamsScope();
+  rngStreamsScope(const rngStreamsScope &) = delete;
+  rngStreamsScope &operator=(const rngStreamsScope &) = delete;
+};
+
+/*
+ * Draw from the given stream (on this thread) while in scope; scopes
+ * nest, so items made while building a level still come from LOOT.
+ */
+class rngScope {
+private:
+  const rngStream prev_;
+public:
+  explicit rngScope(rngStream s);
+  ~rngScope();
+  rngScope(const rngScope &) = delete;
+  rngScope &operator=(const rngScope &) = delete;
+};
+
+/*
+ * The stream of the innermost rngScope on this thread (or GENERAL).
+ * This holds no state of its own, so may be passed to any distribution.
+ */
+class currentStream {
+public:
+  typedef xoshiro256::result_type result_type;
+  static constexpr result_type min() { return xoshiro256::min(); }
+  static constexpr result_type max() { return xoshiro256::max(); }
+  result_type operator()();
+};
+extern currentStream generator;
+
+int numRooms(); // 3 to 5
+int roomWidth(); // 5 to 10
+int roomHeight(); // 3 to 6
+int coinFlip(); // 0 or 1
+int corridorDir(); // 0 or 1
+int numItems(); // -4 to 4
+
+/*
+ * Uniform number from 0 (inclusive) to n (exclusive) from one 64-bit
+ * draw, by scaling the top 32 bits (Lemire's method, without the
+ * rejection step); the bias is at most n in 2^32, which no player will
+ * notice. Quicker than a uniform_int_distribution for small ranges.
+ */
+template <typename G>
+uint32_t rndBelow(G &gen, const uint32_t n) {
+  static_assert(G::min() == 0 && G::max() == UINT64_MAX, "rndBelow needs 64 random bits");
+  return static_cast<uint32_t>(((gen() >> 32) * n) >> 32);
+}
 
 /*
  * "Pick a card" method (uniform distribution)
@@ -47,6 +157,17 @@ Iter rndPick(/*by value*/Iter start, const Iter &end) {
   return start;
 }
 
+// as rndPick, but drawing from the given engine rather than the shared one
+template <typename G, typename Iter>
+Iter rndPick(G &gen, /*by value*/Iter start, const Iter &end) {
+  const auto max = std::distance(start, end);
+  if (max > 1) {
+    std::uniform_int_distribution<int> dis(0, max - 1);
+    std::advance(start, dis(gen));
+  }
+  return start;
+}
+
 // as rndPick, but between 2 numbers:
 template <typename I>
 I rndPickI(/*by value*/I start, const I end) {
@@ -108,13 +229,30 @@ E rndPick() {
  * Called D% for brevity, but distinct from a traditional uniform percentile die.
  */
 unsigned char dPc();
+// dPc()'s inverse CDF: all 51*51 equally-likely rolls, in ascending order
+inline const unsigned char *dPcTable() {
+  struct table {
+    unsigned char v_[51*51];
+    table() {
+      unsigned char *p = v_;
+      // there are 51-|n-50| ways to roll n, so list each that many times:
+      for (int n = 0; n <= 100; ++n)
+	for (int ways = 51 - std::abs(n - 50); ways > 0; --ways)
+	  *(p++) = static_cast<unsigned char>(n);
+    }
+  };
+  static const table t;
+  return t.v_;
+}
+// as dPc(), but drawing from the given engine rather than the shared one
+template <typename G>
+unsigned char dPc(G &gen) {
+  return dPcTable()[rndBelow(gen, 51*51)];
+}
 
 /*
  * Used for random generation on levels (items, monsters, etc)
  *
- * I concept is a const random-access iterator of T.
- * I must be assignable.
- *
  * T concept must provide:
  * ((int getLevelFactor() : dungeon level factor (F) - not used; specifies power of monster))
  * int getLevelOffset() : dungeon level offset (O)
@@ -129,41 +267,30 @@ unsigned char dPc();
  * where "R" is the number of rooms in the level.
  *
  * Params:
- * from, to => options for generation
- * l => current level (L)
+ * eligible => options for generation, already limited to those allowed
+ *             at this level (L >= O), so they can be worked out once per
+ *             depth rather than on every call; see spawnMonsters()
  * r => number of rooms (R) in current level
  *
  * Returns a list of pairts of quantity and T
  */
-template<typename T, typename I>
+template<typename T>
 std::vector<std::pair<unsigned int, T>>
-rndGen(const I &from, const I & to, 
-       const unsigned char l, const unsigned char r) {
-  // first work out which items are allowed:
-  std::vector<T> buffer;
- 
-  for (auto i = from; i < to; ++i) {
-    auto o = (*i)->getLevelOffset(); // TODO: unsure if this is being used consistently
-    if (l >= o)
-      buffer.push_back(*i);
-  }
-  auto max = buffer.size();
-  std::uniform_int_distribution<int> dis(0, max - 1);
-
+rndGen(const std::vector<T> &eligible, const unsigned char r) {
   // now we work out how many T's we need
   int numGroups;
-  if (r < 1) numGroups = 0; // nothing to emplace
+  if (r < 1 || eligible.empty()) numGroups = 0; // nothing to emplace
   else if (r == 1) numGroups = 1; // always place a monster if we can
-  else {
-    std::uniform_int_distribution<int> ng(r / 2, r);
-    numGroups = ng(generator);
-  }
+  else numGroups = r / 2 + rndBelow(generator, r - r / 2 + 1);
   std::vector<std::pair<unsigned int, T>> rtn;
+  rtn.reserve(numGroups);
   for (auto counter = 0; counter < numGroups; ++counter) {
-    auto idx = dis(generator);
-    auto &i = buffer[idx];
-    std::uniform_int_distribution<int> ng((*i).getMinSpawn(), (*i).getMaxSpawn());
-    rtn.emplace_back(ng(generator), i);
+    // each eligible T is equally likely, so one draw picks it:
+    const T &i = eligible[rndBelow(generator, eligible.size())];
+    const int mn = (*i).getMinSpawn(), mx = (*i).getMaxSpawn();
+    rtn.emplace_back(mn + (mx > mn ? rndBelow(generator, mx - mn + 1) : 0), i);
   }
   return rtn;
 }
+
+#endif //ndef RANDOM_HPP
@@ -59,17 +59,21 @@ public:
   void publish() {
     auto pc = dungeon_.pc();
     auto a = pc->abilities();
+    // sights only reach the player if there's a clear view of where they happen:
+    auto &lvl = pc->curLevel();
+    const coord pcPos = lvl.posOf(*pc);
+    const bool inView = !loc_ || pcPos.first < 0 || lvl.canSee(pcPos, loc_.value(), level::MAX_WIDTH);
     // first find the format message
     std::wstring buffer = L"";
     bool hasDir = false;
     if (loc_)
       for (auto s : sense_) {
-	if (hasSense(s, a)) { hasDir = true; break; }
+	if (hasSense(s, a, inView)) { hasDir = true; break; }
       }
     size_t id=0;
     for (auto s : sense_) {
       std::wstring &f = msg_[id++];
-      if (hasSense(s, a)) {
+      if (hasSense(s, a, inView)) {
 	buffer = f;
 	break;
       }
@@ -114,8 +118,8 @@ private:
     if (dtv_ > 100) dtv_ = dPc();
     return dtv_;
   }
-  bool hasSense(sense::sense &s, const std::shared_ptr<monsterAbilities> &a) {
-    return (s & sense::SIGHT && a->hasSense(sense::SIGHT)) ||
+  bool hasSense(sense::sense &s, const std::shared_ptr<monsterAbilities> &a, const bool inView) {
+    return (s & sense::SIGHT && inView && a->hasSense(sense::SIGHT)) ||
 	  (s & sense::SOUND && a->hasSense(sense::SOUND)) ||
 	  (s & sense::TOUCH && a->hasSense(sense::TOUCH)) || // NB: this filters for no gloves etc; see monsterAbilites.cpp
 	  (s & sense::TASTE && a->hasSense(sense::TASTE)) ||
@@ -196,6 +196,7 @@ private:
       }
   }
   void restock() {
+    rngScope loot(rngStream::LOOT);
     unsigned int numItems = 4 + (dPc() / 20); // 4 to 9
     auto cat = itemCat();
     itemHolder h;
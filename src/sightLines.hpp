@@ -0,0 +1,69 @@
+/* License and copyright go here*/
+
+// precomputed straight lines from a square to those around it
+
+#ifndef SIGHTLINES_HPP
+#define SIGHTLINES_HPP
+
+#include <array>
+#include <cstdlib> // abs
+#include <utility> // pair
+#include <vector>
+#include "coord.hpp"
+
+/*
+ * For every offset within R moves of a square, the squares passed
+ * through stepping straight there with coord::towards(): from the start
+ * (inclusive) to the end (exclusive), as offsets from the start.
+ * Lines don't depend on where they start, so one table serves every
+ * square of every level; walking one is then just a few additions.
+ */
+template <int R>
+class sightLines {
+public:
+  static constexpr int radius = R;
+  typedef std::pair<signed char, signed char> offset;
+  typedef typename std::vector<offset>::const_iterator iterator;
+private:
+  static constexpr int side = 2*R+1;
+  // every line, end to end
+  std::vector<offset> steps_;
+  // where each line starts in steps_; the last entry is the end of the last line
+  std::array<unsigned int, side*side+1> begin_;
+
+  static int index(const int dx, const int dy) {
+    return (dy + R) * side + dx + R;
+  }
+public:
+  sightLines() :
+    steps_(), begin_() {
+    for (int dy = -R; dy <= R; ++dy)
+      for (int dx = -R; dx <= R; ++dx) {
+	begin_[index(dx, dy)] = steps_.size();
+	const coord end(dx, dy);
+	for (coord c(0,0); c != end; c = c.towards(end))
+	  steps_.emplace_back(c.first, c.second);
+      }
+    begin_[side*side] = steps_.size();
+  }
+  sightLines(const sightLines &) = delete;
+  sightLines &operator=(const sightLines &) = delete;
+
+  // is the offset (dx,dy) in the table?
+  static bool inRange(const int dx, const int dy) {
+    return std::abs(dx) <= R && std::abs(dy) <= R;
+  }
+  // first step of the line to (dx,dy), which must be inRange()
+  iterator begin(const int dx, const int dy) const {
+    return steps_.begin() + begin_[index(dx, dy)];
+  }
+  // end of the line to (dx,dy), which must be inRange()
+  iterator end(const int dx, const int dy) const {
+    return steps_.begin() + begin_[index(dx, dy) + 1];
+  }
+};
+
+template <int R>
+constexpr int sightLines<R>::radius;
+
+#endif //ndef SIGHTLINES_HPP
@@ -1,6 +1,6 @@
 /* License and copyright go here*/
 
-#include <map>
+#include <array>
 #include "terrain.hpp"
 #include "monster.hpp"
 #include "random.hpp"
@@ -103,6 +103,10 @@ bool terrain::entraps(const monster &m, bool includeHidden) const {
   }
 }
 
+bool terrain::opaque() const {
+  return type_ == terrainType::ROCK || type_ == terrainType::BULKHEAD || type_ == terrainType::KNOTWEED;
+}
+
 bool terrain::shouldSupportItems() const {
   return type_ != terrainType::FIRE && type_ != terrainType::WATER && type_ != terrainType::WELL && type_ != terrainType::WISHING_WELL;
 }
@@ -117,7 +121,8 @@ bool terrain::operator !=(const terrain &other) const {
 
 class terrainFactoryImpl {
 private:
-  ::std::map<terrainType, ::std::unique_ptr<terrain>> store_;
+  // indexed by terrainType, so lookups are constant-time:
+  std::array<std::unique_ptr<terrain>, terrainTypeSize> store_;
 public:
   terrainFactoryImpl() {
     store(new terrain(L'Π', L"Altar", L"Idol of worship; placed in shrines for vereration of the gods", terrainType::ALTAR));
@@ -155,11 +160,11 @@ public:
     store(new terrain(L'⍌', L"Wishing Well", L"Throw in a coin; used to make a wish. Supplies fresh drinking water.", terrainType::WISHING_WELL));
   }
   const terrain &get(terrainType type) const {
-    return *(store_.at(type).get());
+    return *(store_.at(static_cast<size_t>(type)).get());
   }
 private:
   void store(terrain * t) {
-    store_[t->type()] = std::unique_ptr<terrain>(t);
+    store_[static_cast<size_t>(t->type())] = std::unique_ptr<terrain>(t);
   }
 };
 
@@ -10,7 +10,8 @@
 
 class monster;
 
-enum class terrainType {
+// stored one byte per square in each level, so keep this small:
+enum class terrainType : unsigned char {
   ALTAR, // placed in shrines
   ROCK, // undiggable terrain.
   GROUND, // general movable areas. Currently, this means a room and is elegable to be replaced by a stairwell.
@@ -37,8 +38,11 @@ enum class terrainType {
   DECK,
   WELL, // supplies water on using empty bottle, dilutes other liquids in bottles.
   WISHING_WELL, // as well + dropped objects disappear (unless highlighted), use for wish.
+  END
 };
 
+const long unsigned int terrainTypeSize = static_cast<unsigned long>(terrainType::END);
+
 const wchar_t * const to_string(const terrainType &);
 
 class terrain : public renderable {
@@ -66,6 +70,9 @@ public:
   // does this behave like ordinary ground?
   bool groundLike() const;
 
+  // does this block line of sight? (see fov.hpp)
+  bool opaque() const;
+
   // can I put my thing here? (NB: all terrain support items, so quest items are never lost, but some shouldn't)
   bool shouldSupportItems() const;
   
@@ -0,0 +1,72 @@
+/* License and copyright go here*/
+
+// a fixed set of worker threads, for running independent jobs side by side
+
+#include "threadPool.hpp"
+
+threadPool::threadPool(unsigned int threads) :
+  workers_(), lock_(), start_(), done_(),
+  job_(nullptr), size_(0), next_(0), running_(0), batch_(0),
+  error_(), stop_(false) {
+  for (unsigned int i = 1; i < threads; ++i)
+    workers_.emplace_back([this]() { worker(); });
+}
+
+threadPool::~threadPool() {
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    stop_ = true;
+  }
+  start_.notify_all();
+  for (auto &t : workers_) t.join();
+}
+
+void threadPool::work(std::unique_lock<std::mutex> &lock) {
+  while (next_ < size_) {
+    const size_t i = next_++;
+    lock.unlock();
+    try {
+      (*job_)(i);
+    } catch (...) {
+      lock.lock();
+      if (!error_) error_ = std::current_exception();
+      next_ = size_; // give up on the rest
+      continue;
+    }
+    lock.lock();
+  }
+}
+
+void threadPool::worker() {
+  std::unique_lock<std::mutex> lock(lock_);
+  unsigned long seen = batch_;
+  while (true) {
+    start_.wait(lock, [this, seen]() { return stop_ || batch_ != seen; });
+    if (stop_) return;
+    seen = batch_;
+    ++running_;
+    work(lock);
+    if (--running_ == 0) done_.notify_one();
+  }
+}
+
+void threadPool::run(size_t count, const std::function<void(size_t)> &job) {
+  std::unique_lock<std::mutex> lock(lock_);
+  job_ = &job;
+  size_ = count;
+  next_ = 0;
+  error_ = nullptr;
+  ++batch_;
+  start_.notify_all();
+  ++running_;
+  work(lock);
+  --running_;
+  // wait for any worker still finishing a job:
+  done_.wait(lock, [this]() { return running_ == 0; });
+  job_ = nullptr;
+  if (error_) {
+    std::exception_ptr e = error_;
+    error_ = nullptr;
+    std::rethrow_exception(e);
+  }
+}
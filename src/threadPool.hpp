@@ -0,0 +1,52 @@
+/* License and copyright go here*/
+
+// a fixed set of worker threads, for running independent jobs side by side
+
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Runs a numbered batch of jobs across a fixed set of threads, and
+ * waits for them all to finish. The calling thread joins in, so a pool
+ * of N threads uses N-1 workers. Jobs are handed out in order, but may
+ * finish in any order; they must not depend on each other.
+ *
+ * If any job throws, the first exception is rethrown from run() once
+ * the batch is finished.
+ */
+class threadPool {
+private:
+  std::vector<std::thread> workers_;
+  std::mutex lock_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  // the current batch:
+  const std::function<void(size_t)> *job_;
+  size_t size_;
+  size_t next_; // next job to hand out
+  size_t running_; // threads still working on this batch
+  unsigned long batch_; // bumped for each batch, so workers can tell it's new
+  std::exception_ptr error_;
+  bool stop_;
+  // take jobs until there are none left; called with lock held
+  void work(std::unique_lock<std::mutex> &lock);
+  void worker();
+public:
+  explicit threadPool(unsigned int threads);
+  threadPool(const threadPool &) = delete;
+  threadPool &operator=(const threadPool &) = delete;
+  ~threadPool();
+  // how many threads (including the caller) run each batch
+  unsigned int size() const { return workers_.size() + 1; }
+  // call job(0) .. job(count-1), and return when all are done
+  void run(size_t count, const std::function<void(size_t)> &job);
+};
+
+#endif //ndef THREADPOOL_HPP
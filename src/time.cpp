@@ -3,11 +3,12 @@
 // track time spent in the dungeon
 
 #include "time.hpp"
+#include "random.hpp"
+#include <array>
 #include <vector>
-#include <algorithm>
 
 temporal::callback::callback(bool everyTick, const std::function<void()> &fn) :
-  callback_(fn), everyTick_(everyTick) {
+  callback_(fn), everyTick_(everyTick), slot_(0), generation_(0) {
   if (everyTick_) ::time::onTick(*this);
   else ::time::onPlayerMove(*this);
 }
@@ -27,12 +28,195 @@ bool temporal::callback::operator ==(const temporal::callback &rhs) {
   return &(callback_) == &(rhs.callback_);
 }
 
+/*
+ * Registered callbacks, in slots which are reused once vacated.
+ * A callback records its slot, so adding and removing are constant-time
+ * and need no searching, even in the middle of a tick. Each slot has a
+ * generation, bumped when it is vacated, so a callback can tell whether
+ * it still holds the slot it was given. Generations start at 1, so a
+ * new callback (generation 0) is never mistaken for a registered one.
+ * Callbacks are invoked in the order they were registered, from a list
+ * of slots and generations; stale entries are skipped, and swept out
+ * once they make up half the list.
+ */
+class callbackSlots {
+private:
+  struct slot {
+    time::callback *cb_; // nullptr if vacant
+    unsigned int generation_;
+    unsigned long long since_; // time::moveCount() when registered
+  };
+  std::vector<slot> slots_;
+  std::vector<unsigned int> free_;
+  // slots and generations, in registration order
+  std::vector<std::pair<unsigned int, unsigned int> > order_;
+  size_t stale_; // entries in order_ no longer registered
+  bool invoking_; // don't sweep order_ while we walk it
+  bool live(const std::pair<unsigned int, unsigned int> &p) const {
+    return slots_[p.first].cb_ != nullptr && slots_[p.first].generation_ == p.second;
+  }
+  void sweep() {
+    if (invoking_ || stale_ * 2 <= order_.size()) return;
+    size_t to = 0;
+    for (auto &p : order_)
+      if (live(p)) order_[to++] = p;
+    order_.resize(to);
+    stale_ = 0;
+  }
+public:
+  callbackSlots() : slots_(), free_(), order_(), stale_(0), invoking_(false) {}
+  void add(time::callback &cb, unsigned long long now) {
+    if (registered(cb)) return;
+    sweep();
+    unsigned int idx;
+    if (free_.empty()) {
+      idx = slots_.size();
+      slots_.push_back(slot{nullptr, 1, 0});
+    } else {
+      idx = free_.back();
+      free_.pop_back();
+    }
+    slot &s = slots_[idx];
+    s.cb_ = &cb;
+    s.since_ = now;
+    cb.slot_ = idx;
+    cb.generation_ = s.generation_;
+    order_.emplace_back(idx, s.generation_);
+  }
+  void remove(time::callback &cb) {
+    if (!registered(cb)) return;
+    slot &s = slots_[cb.slot_];
+    s.cb_ = nullptr;
+    ++s.generation_;
+    free_.push_back(cb.slot_);
+    cb.generation_ = 0;
+    ++stale_;
+  }
+  bool registered(const time::callback &cb) const {
+    return cb.generation_ != 0 && cb.slot_ < slots_.size() &&
+      slots_[cb.slot_].cb_ == &cb && slots_[cb.slot_].generation_ == cb.generation_;
+  }
+  // invoke each callback registered before this tick, in registration order
+  void operator()(unsigned long long now) {
+    invoking_ = true;
+    // by index, as callbacks may register more
+    const size_t end = order_.size();
+    for (size_t i = 0; i < end; ++i) {
+      const auto p = order_[i];
+      if (!live(p)) continue; // removed
+      const slot &s = slots_[p.first];
+      if (s.since_ < now)
+	(*s.cb_)();
+    }
+    invoking_ = false;
+    sweep();
+  }
+};
+
+/*
+ * Hierarchical timer wheel. Each level has a ring of buckets; a bucket
+ * in level 0 holds the timers due on one tick, one in level 1 those due
+ * within a block of 64 ticks, and so on. When the clock reaches the
+ * start of a block, its bucket is redistributed into the finer levels,
+ * so each timer is touched at most once per level. Timers further off
+ * than the wheel reaches wait in the last level and are redistributed
+ * until they come within reach.
+ */
+class timerWheel {
+private:
+  static constexpr int bits = 6;
+  static constexpr unsigned long long span = 1ull << bits; // buckets per level
+  static constexpr int levels = 4; // reaches 2^24 ticks ahead
+  struct entry {
+    std::function<void()> fn_;
+    unsigned long long due_;
+    unsigned int generation_; // bumped when the timer fires or is cancelled
+  };
+  // timers, in slots reused once vacated (see callbackSlots)
+  std::vector<entry> entries_;
+  std::vector<unsigned int> free_;
+  // each bucket holds slots and generations; stale ones are skipped
+  typedef std::vector<std::pair<unsigned int, unsigned int> > bucket;
+  std::array<std::array<bucket, span>, levels> wheel_;
+  // spare bucket to swap in while one is emptied, so buckets keep their capacity
+  bucket work_;
+
+  void place(unsigned int slot, unsigned long long now) {
+    const entry &e = entries_[slot];
+    const unsigned long long delta = e.due_ - now;
+    int level = 0;
+    while (level < levels - 1 && delta >= (span << (bits * level))) ++level;
+    const unsigned long long due = level == levels - 1 && delta >= (span << (bits * level)) ?
+      now + (span << (bits * level)) - 1 : // beyond reach; redistribute when we get there
+      e.due_;
+    wheel_[level][(due >> (bits * level)) & (span - 1)].emplace_back(slot, e.generation_);
+  }
+  bool live(const std::pair<unsigned int, unsigned int> &p) const {
+    return entries_[p.first].generation_ == p.second;
+  }
+  void release(unsigned int slot) {
+    entry &e = entries_[slot];
+    e.fn_ = nullptr;
+    ++e.generation_;
+    free_.push_back(slot);
+  }
+public:
+  timerWheel() : entries_(), free_(), wheel_(), work_() {}
+  time::timer add(unsigned long long due, unsigned long long now, const std::function<void()> &fn) {
+    unsigned int slot;
+    if (free_.empty()) {
+      slot = entries_.size();
+      entries_.push_back(entry{nullptr, 0, 1});
+    } else {
+      slot = free_.back();
+      free_.pop_back();
+    }
+    entry &e = entries_[slot];
+    e.fn_ = fn;
+    e.due_ = due;
+    place(slot, now);
+    time::timer rtn;
+    rtn.slot_ = slot;
+    rtn.generation_ = e.generation_;
+    return rtn;
+  }
+  bool pending(const time::timer &t) const {
+    return t.generation_ != 0 && t.slot_ < entries_.size() &&
+      entries_[t.slot_].generation_ == t.generation_;
+  }
+  void cancel(const time::timer &t) {
+    if (pending(t)) release(t.slot_);
+  }
+  // fire everything due at now; called once for every tick
+  void operator()(unsigned long long now) {
+    // redistribute any coarser buckets starting a new block, coarsest first:
+    for (int level = levels - 1; level > 0; --level) {
+      if ((now & ((1ull << (bits * level)) - 1)) != 0) continue;
+      work_.swap(wheel_[level][(now >> (bits * level)) & (span - 1)]);
+      for (auto &p : work_)
+	if (live(p)) place(p.first, now);
+      work_.clear();
+    }
+    work_.swap(wheel_[0][now & (span - 1)]);
+    for (auto &p : work_) {
+      if (!live(p)) continue; // cancelled
+      // release first, so the timer is no longer pending, and fn may add more timers
+      std::function<void()> fn;
+      fn.swap(entries_[p.first].fn_);
+      release(p.first);
+      fn();
+    }
+    work_.clear();
+  }
+};
+
 class timeImpl {
   friend class time;
 private:
   long long moveCount_;
-  std::vector<time::callback*> playerMoveCallbacks_;
-  std::vector<time::callback*> tickCallbacks_;
+  callbackSlots playerMoveCallbacks_;
+  callbackSlots tickCallbacks_;
+  timerWheel timers_;
 };
 
 std::unique_ptr<timeImpl> time::instance_(new timeImpl());
@@ -43,39 +227,42 @@ unsigned long long time::moveCount() {
 
 
 void time::tick(bool isMove) {
-  ++ (instance_->moveCount_);
-  if (isMove) {
-    auto &ref = instance_->playerMoveCallbacks_;
-    auto copy = ref;
-    for (auto f : copy)
-      if (std::find(ref.begin(), ref.end(), f) != ref.end())
-	(*f)();
-  }
-  auto &ref = instance_->tickCallbacks_;
-  auto copy = ref;
-  for (auto f : copy)
-    if (std::find(ref.begin(), ref.end(), f) != ref.end())
-      (*f)(); 
+  const unsigned long long now = ++ (instance_->moveCount_);
+  if (isMove)
+    instance_->playerMoveCallbacks_(now);
+  instance_->tickCallbacks_(now);
+  instance_->timers_(now);
 }
 void time::onPlayerMove(time::callback &onMove) {
-  instance_->playerMoveCallbacks_.push_back(&onMove);
+  instance_->playerMoveCallbacks_.add(onMove, instance_->moveCount_);
 }
 void time::onTick(time::callback &onMove) {
-  instance_->tickCallbacks_.push_back(&onMove);
+  instance_->tickCallbacks_.add(onMove, instance_->moveCount_);
 }
 
-
-// Ah, the erase/remove idiom. Score one for Java, where this is just a method in AbstractList().
-
 void time::offPlayerMove(time::callback &onMove) {
-  auto &v = instance_->playerMoveCallbacks_;
-  v.erase(std::remove(v.begin(), v.end(), &onMove), v.end());
-  //  std::vector<time::callback>::iterator newEnd = std::remove
-  //    (v.begin(), v.end(), [callback](time::callback &c){return &c == &callback;});
-  //  v.erase(newEnd, v.end());
+  instance_->playerMoveCallbacks_.remove(onMove);
 }
 
 void time::offTick(time::callback &onMove) {
-  auto &v = instance_->tickCallbacks_;
-  v.erase(std::remove(v.begin(), v.end(), &onMove), v.end());
+  instance_->tickCallbacks_.remove(onMove);
+}
+
+time::timer time::after(unsigned long ticks, const std::function<void()> &fn) {
+  const unsigned long long now = instance_->moveCount_;
+  return instance_->timers_.add(now + (ticks == 0 ? 1 : ticks), now, fn);
+}
+
+time::timer time::afterChance(double p, const std::function<void()> &fn) {
+  // number of failed rolls before the first success:
+  std::geometric_distribution<unsigned long> failures(p);
+  return after(1 + failures(generator), fn);
+}
+
+bool time::pending(const time::timer &t) {
+  return instance_->timers_.pending(t);
+}
+
+void time::cancel(const time::timer &t) {
+  instance_->timers_.cancel(t);
 }
@@ -9,12 +9,18 @@
 #include <functional>
 
 class timeImpl;
+class callbackSlots;
+class timerWheel;
 
 namespace temporal {
   class callback {
   private:
+    friend class ::callbackSlots;
     const std::function<void()> callback_;
     const bool everyTick_;
+    // where this is registered with time; see timeImpl
+    unsigned int slot_;
+    unsigned int generation_;
   public:
     // consume the given callback
     // everyTick - true to register on tick, falso on player move
@@ -30,6 +36,17 @@ namespace temporal {
     // comparison for adding and removing
     bool operator ==(const callback &rhs);
   };
+
+  // handle to a one-off delayed call; see time::after()
+  class timer {
+  private:
+    friend class ::timerWheel;
+    unsigned int slot_;
+    unsigned int generation_;
+  public:
+    // a handle to nothing
+    timer() : slot_(0), generation_(0) {}
+  };
 };
 
 class time {
@@ -37,6 +54,7 @@ private:
   static std::unique_ptr<timeImpl> instance_;
 public:
   typedef ::temporal::callback callback; 
+  typedef ::temporal::timer timer;
   /*
    * The number of ticks that have elapsed in the game
    */
@@ -50,6 +68,9 @@ public:
   /*
    * Register callbacks for player movement
    * I/O routines generally call this.
+   * Callbacks may be registered and unregistered during a tick; any
+   * registered during a tick are first invoked on the next one.
+   * Registering a callback which is already registered does nothing.
    */
   static void onPlayerMove( time::callback &onMove); // register
   static void offPlayerMove( time::callback &onMove); // unregister
@@ -59,6 +80,22 @@ public:
    */
   static void onTick( time::callback &onMove); // register
   static void offTick( time::callback &onMove); // unregister
+  /*
+   * Call fn once, after the given number of ticks (at least 1).
+   * Pending calls are kept in a timer wheel, so they cost nothing on
+   * the ticks in between; use this rather than a callback which counts
+   * down every tick.
+   */
+  static timer after(unsigned long ticks, const std::function<void()> &fn);
+  /*
+   * Call fn once, with chance p (0 < p <= 1) on each tick. The delay is
+   * drawn once, up front, and is on average 1/p ticks.
+   */
+  static timer afterChance(double p, const std::function<void()> &fn);
+  // is the call still to come?
+  static bool pending(const timer &t);
+  // prevent the call, if it hasn't happened yet
+  static void cancel(const timer &t);
 };
 
 
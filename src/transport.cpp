@@ -5,7 +5,7 @@
 #include "time.hpp"
 #include "random.hpp"
 #include "level.hpp"
-#include "pathfinder.hpp"
+#include "astar.hpp"
 
 transport::transport(terrainType activate, 
 		     terrainType allow,
@@ -98,7 +98,7 @@ void transport::selfMove() {
     return;
   case goTo::crack: {
     // seek out a crack
-    auto cracks = lvl_->findAllTerrain(terrainType::CRACK);
+    const auto &cracks = lvl_->findAllTerrain(terrainType::CRACK);
     auto pCrack = rndPick(cracks.begin(), cracks.end());
     if (pCrack == cracks.end()) return; // does not move
     targetPos = *pCrack;
@@ -106,7 +106,7 @@ void transport::selfMove() {
   }
   case goTo::web: {
     // seek out a crack
-    auto cracks = lvl_->findAllTerrain(terrainType::WEB);
+    const auto &cracks = lvl_->findAllTerrain(terrainType::WEB);
     auto pCrack = rndPick(cracks.begin(), cracks.end());
     if (pCrack == cracks.end()) return; // does not move
     targetPos = *pCrack;
@@ -114,13 +114,14 @@ void transport::selfMove() {
   }
   }
 
-  dir d = pathfinder<12>([this](const coord &c){
+  static astar<12> finder;
+  dir d = finder.find(curPos, targetPos, [this](const coord &c){
       if (c.first < 0 || c.second < 0 ||
 	  c.first > level::MAX_WIDTH ||
 	  c.second > level::MAX_HEIGHT)
 	return false;
       return lvl_->terrainAt(c) == terrainToAllow_;
-    }).find(curPos, targetPos);
+    });
 
   lvl_->holder(curPos.inDir(d)).addItem(*pThis);
 }